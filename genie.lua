@@ -24,11 +24,13 @@ project "fbx_sdk"
 		"genie.lua"
 	}
 	
+	removefiles { "src/cli/*" }
 	if not build_studio then
 		removefiles { "src/editor/*" }
 	end
 	
 	includedirs { "../../luxmiengine_fbx/src", 
+		"../LumixEngine/external", 
 		"../LumixEngine/external/lua/include", 
 		"../LumixEngine/external/bgfx/include"
 	}
@@ -40,6 +42,26 @@ project "fbx_sdk"
 linkPlugin("fbx_sdk")
 
 
+project "fbx_import"
+	kind "ConsoleApp"
+	files { 
+		"src/cli/*.cpp",
+		"src/*.cpp",
+		"src/*.h"
+	}
+	-- studio plugin entry
+	removefiles { "src/main.cpp" }
+	includedirs { "../../luxmiengine_fbx/src", 
+		"../LumixEngine/external", 
+		"../LumixEngine/external/lua/include", 
+		"../LumixEngine/external/bgfx/include"
+	}
+	links { "engine" }
+	linkFBX()
+
+	defaultConfigurations()
+
+
 table.insert(build_app_callbacks, linkFBX)
 table.insert(build_studio_callbacks, linkFBX)
 
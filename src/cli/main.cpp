@@ -0,0 +1,295 @@
+#include "engine/allocators.h"
+#include "engine/job_system.h"
+#include "engine/log.h"
+#include "engine/os.h"
+#include "engine/string.h"
+#include "../fbx_importer.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+
+using namespace Lumix;
+
+
+static void logToStdout(LogLevel level, const char* system, const char* message)
+{
+	FILE* stream = level == LogLevel::ERROR ? stderr : stdout;
+	fprintf(stream, "[%s] %s\n", system, message);
+}
+
+
+static void printUsage()
+{
+	printf("Usage: fbx_import [options] file.fbx [file2.fbx ...]\n"
+		   "Options:\n"
+		   "  -o, --output <dir>         output directory\n"
+		   "  -t, --textures <dir>       texture directory referenced by materials\n"
+		   "  -n, --name <name>          output mesh filename, defaults to the first source's name\n"
+		   "  -c, --cache <dir>          reuse outputs of unchanged sources and options from this directory\n"
+		   "  --scale <value>            mesh scale\n"
+		   "  --bounding-scale <value>   bounding shape scale\n"
+		   "  --anim-error <value>       max world space joint error of reduced animations, default 0.001\n"
+		   "  --root-motion <bone>       bake horizontal translation and yaw of the bone to a root motion track\n"
+		   "  --additive <clip>          bake all other clips as additive deltas against this one\n"
+		   "  --center                   center meshes\n"
+		   "  --ignore-skeleton          do not import skeleton and skinning\n"
+		   "  --orientation <y|z|-z|-x>  up axis of the source files\n"
+		   "  --native                   use the native binary FBX reader\n"
+		   "  --serial                   load sources one after another instead of concurrently\n"
+		   "  --no-optimize              keep triangle and vertex order as exported\n"
+		   "  --no-blend-shapes          do not import blend shapes\n"
+		   "  --extended                 allow output the engine cannot load yet: blend shapes, the formats below, root motion, additive\n"
+		   "  --positions <float|u16>    vertex position format, u16 is normalized to the mesh bounds\n"
+		   "  --uvs <float|half|u16>     texture coordinate format\n"
+		   "  --normals <u8|oct>         normal and tangent format, oct is 16-bit octahedral\n"
+		   "  --skin <float|u8>          joint weight format, u8 uses 8-bit joint indices\n"
+		   "  --anim-keys <float|q48|q32> animation key format, quantized keys use smallest three rotations\n"
+		   "  --dds                      convert diffuse and normal textures to BC compressed DDS\n"
+		   "  --physics                  cook convex hulls and a collision mesh of every mesh to a .phy file\n"
+		   "  --decompose                split physics meshes into several convex hulls\n"
+		   "  --max-concavity <value>    concavity a decomposed hull may have relative to mesh size, default 0.02\n"
+		   "  --max-hulls <count>        convex hulls per decomposed mesh, default 16\n"
+		   "  --bc7                      BC7 instead of BC1/BC3 for converted color textures\n"
+		   "  --compact                  smallest format for all of the above, needs --extended\n"
+		   "  --lods                     generate LOD1-LOD3 unless the source has LOD meshes\n"
+		   "  --lod-ratios <a,b,c>       triangle ratio of generated LODs, default 0.5,0.25,0.125\n"
+		   "  --lod-errors <a,b,c>       max error of generated LODs relative to mesh size, default 0.01,0.02,0.04\n"
+		   "  --lod-distances <a,b,c,d>  LOD switch distances\n"
+		   "  --trace <file.json>        write stage timings and file counters as a Chrome trace\n"
+		   "  --benchmark                compare the SDK and native readers, do not convert\n");
+}
+
+
+static bool parseOrientation(const char* str, FBXImporter::Orientation& out)
+{
+	if (equalStrings(str, "y")) out = FBXImporter::Orientation::Y_UP;
+	else if (equalStrings(str, "z")) out = FBXImporter::Orientation::Z_UP;
+	else if (equalStrings(str, "-z")) out = FBXImporter::Orientation::Z_MINUS_UP;
+	else if (equalStrings(str, "-x")) out = FBXImporter::Orientation::X_MINUS_UP;
+	else return false;
+	return true;
+}
+
+
+static bool parseVertexFormat(const char* option, const char* value, FBXImporter& importer)
+{
+	if (equalStrings(option, "--positions"))
+	{
+		if (equalStrings(value, "float")) importer.position_format = FBXImporter::PositionFormat::FLOAT;
+		else if (equalStrings(value, "u16")) importer.position_format = FBXImporter::PositionFormat::UNORM16;
+		else return false;
+	}
+	else if (equalStrings(option, "--uvs"))
+	{
+		if (equalStrings(value, "float")) importer.uv_format = FBXImporter::UVFormat::FLOAT;
+		else if (equalStrings(value, "half")) importer.uv_format = FBXImporter::UVFormat::HALF;
+		else if (equalStrings(value, "u16")) importer.uv_format = FBXImporter::UVFormat::UNORM16;
+		else return false;
+	}
+	else if (equalStrings(option, "--normals"))
+	{
+		if (equalStrings(value, "u8")) importer.normal_format = FBXImporter::NormalFormat::PACKED_U8;
+		else if (equalStrings(value, "oct")) importer.normal_format = FBXImporter::NormalFormat::OCTAHEDRAL;
+		else return false;
+	}
+	else if (equalStrings(option, "--anim-keys"))
+	{
+		if (equalStrings(value, "float")) importer.animation_format = FBXImporter::AnimationFormat::FLOAT;
+		else if (equalStrings(value, "q48")) importer.animation_format = FBXImporter::AnimationFormat::QUANTIZED_48;
+		else if (equalStrings(value, "q32")) importer.animation_format = FBXImporter::AnimationFormat::QUANTIZED_32;
+		else return false;
+	}
+	else if (equalStrings(option, "--skin"))
+	{
+		if (equalStrings(value, "float")) importer.skin_format = FBXImporter::SkinFormat::FLOAT;
+		else if (equalStrings(value, "u8")) importer.skin_format = FBXImporter::SkinFormat::UNORM8;
+		else return false;
+	}
+	else
+	{
+		return false;
+	}
+	return true;
+}
+
+
+static bool parseFloatList(const char* str, float* out, int count)
+{
+	for (int i = 0; i < count; ++i)
+	{
+		char* end;
+		out[i] = (float)strtod(str, &end);
+		if (end == str) return false;
+		if (i + 1 < count && *end != ',') return false;
+		str = end + 1;
+	}
+	return true;
+}
+
+
+static void printStats(const FBXImporter& importer)
+{
+	printf("%-40s %6s %12s %12s\n", "stage", "thread", "time [ms]", "peak [MB]");
+	float total = 0;
+	for (const FBXImporter::StageStats& stats : importer.stage_stats)
+	{
+		const int indent = stats.depth * 2;
+		printf("%*s%-*s %6u %12.2f %12.2f\n",
+			indent,
+			"",
+			40 - indent,
+			stats.name.data,
+			stats.thread,
+			stats.time * 1000,
+			stats.peak_memory / (1024.0 * 1024.0));
+		if (stats.depth == 0 && stats.thread == 0) total += stats.time;
+	}
+	printf("%-40s %6s %12.2f %12.2f\n", "total", "", total * 1000, FBXImporter::getPeakMemory() / (1024.0 * 1024.0));
+
+	printf("\n%-40s %10s %10s %10s %10s %12s %14s\n", "file", "polygons", "points", "clusters", "frames", "size [KB]", "SDK peak [MB]");
+	auto printFiles = [](const Array<FBXImporter::FileStats>& files) {
+		for (const FBXImporter::FileStats& stats : files)
+		{
+			printf("%-40s %10u %10u %10u %10u %12.1f %14.2f\n",
+				stats.path.data,
+				stats.polygons,
+				stats.control_points,
+				stats.clusters,
+				stats.animation_frames,
+				stats.bytes / 1024.0,
+				stats.sdk_peak_memory / (1024.0 * 1024.0));
+		}
+	};
+	printFiles(importer.source_stats);
+	printFiles(importer.output_stats);
+}
+
+
+static int run(IAllocator& allocator, int argc, char** argv)
+{
+	FBXImporter importer(allocator);
+	const char* mesh_name = nullptr;
+	const char* trace_path = nullptr;
+	bool benchmark = false;
+	int first_source = argc;
+	for (int i = 1; i < argc; ++i)
+	{
+		const char* arg = argv[i];
+		const bool has_value = i + 1 < argc;
+		if ((equalStrings(arg, "-o") || equalStrings(arg, "--output")) && has_value) importer.output_dir = argv[++i];
+		else if ((equalStrings(arg, "-t") || equalStrings(arg, "--textures")) && has_value) importer.texture_dir = argv[++i];
+		else if ((equalStrings(arg, "-n") || equalStrings(arg, "--name")) && has_value) mesh_name = argv[++i];
+		else if ((equalStrings(arg, "-c") || equalStrings(arg, "--cache")) && has_value) importer.cache_dir = argv[++i];
+		else if (equalStrings(arg, "--scale") && has_value) importer.mesh_scale = (float)atof(argv[++i]);
+		else if (equalStrings(arg, "--bounding-scale") && has_value) importer.bounding_shape_scale = (float)atof(argv[++i]);
+		else if (equalStrings(arg, "--anim-error") && has_value) importer.animation_max_error = (float)atof(argv[++i]);
+		else if (equalStrings(arg, "--root-motion") && has_value) importer.root_motion_bone = argv[++i];
+		else if (equalStrings(arg, "--additive") && has_value) importer.additive_reference = argv[++i];
+		else if (equalStrings(arg, "--center")) importer.center_mesh = true;
+		else if (equalStrings(arg, "--ignore-skeleton")) importer.ignore_skeleton = true;
+		else if (equalStrings(arg, "--native")) importer.use_native_reader = true;
+		else if (equalStrings(arg, "--serial")) importer.parallel_load = false;
+		else if (equalStrings(arg, "--no-optimize")) importer.optimize_meshes = false;
+		else if (equalStrings(arg, "--no-blend-shapes")) importer.import_blend_shapes = false;
+		else if (equalStrings(arg, "--extended")) importer.extended_formats = true;
+		else if (equalStrings(arg, "--benchmark")) benchmark = true;
+		else if (equalStrings(arg, "--dds")) importer.to_dds = true;
+		else if (equalStrings(arg, "--bc7")) importer.bc7_textures = true;
+		else if (equalStrings(arg, "--physics")) importer.physics_all_meshes = true;
+		else if (equalStrings(arg, "--decompose")) importer.decompose_convex = true;
+		else if (equalStrings(arg, "--max-concavity") && has_value) importer.max_concavity = (float)atof(argv[++i]);
+		else if (equalStrings(arg, "--max-hulls") && has_value) importer.max_convex_hulls = (u32)maximum(atoi(argv[++i]), 1);
+		else if (equalStrings(arg, "--trace") && has_value) trace_path = argv[++i];
+		else if (equalStrings(arg, "--compact"))
+		{
+			importer.position_format = FBXImporter::PositionFormat::UNORM16;
+			importer.uv_format = FBXImporter::UVFormat::HALF;
+			importer.normal_format = FBXImporter::NormalFormat::OCTAHEDRAL;
+			importer.skin_format = FBXImporter::SkinFormat::UNORM8;
+			importer.animation_format = FBXImporter::AnimationFormat::QUANTIZED_48;
+		}
+		else if ((equalStrings(arg, "--positions") || equalStrings(arg, "--uvs") || equalStrings(arg, "--normals")
+					 || equalStrings(arg, "--skin") || equalStrings(arg, "--anim-keys"))
+				 && has_value)
+		{
+			if (!parseVertexFormat(arg, argv[++i], importer))
+			{
+				fprintf(stderr, "Unknown format %s for %s\n", argv[i], arg);
+				return 1;
+			}
+		}
+		else if (equalStrings(arg, "--lods")) importer.generate_lods = true;
+		else if ((equalStrings(arg, "--lod-ratios") || equalStrings(arg, "--lod-errors") || equalStrings(arg, "--lod-distances"))
+				 && has_value)
+		{
+			const char* value = argv[++i];
+			bool valid;
+			if (equalStrings(arg, "--lod-ratios")) valid = parseFloatList(value, importer.lod_ratios, lengthOf(importer.lod_ratios));
+			else if (equalStrings(arg, "--lod-errors")) valid = parseFloatList(value, importer.lod_errors, lengthOf(importer.lod_errors));
+			else valid = parseFloatList(value, importer.lods_distances, lengthOf(importer.lods_distances));
+			if (!valid)
+			{
+				fprintf(stderr, "Invalid value %s for %s\n", value, arg);
+				return 1;
+			}
+		}
+		else if (equalStrings(arg, "--orientation") && has_value)
+		{
+			if (!parseOrientation(argv[++i], importer.orientation))
+			{
+				fprintf(stderr, "Unknown orientation %s\n", argv[i]);
+				return 1;
+			}
+		}
+		else if (arg[0] == '-')
+		{
+			fprintf(stderr, "Unknown option %s\n", arg);
+			printUsage();
+			return 1;
+		}
+		else
+		{
+			first_source = i;
+			break;
+		}
+	}
+
+	if (first_source == argc)
+	{
+		printUsage();
+		return 1;
+	}
+
+	const Span<const char* const> sources(argv + first_source, argv + argc);
+	if (benchmark)
+	{
+		if (!importer.addSources(sources)) return 1;
+		importer.benchmarkReaders();
+		return 0;
+	}
+
+	if (mesh_name) importer.output_mesh_filename = mesh_name;
+	if (!importer.importCached(sources)) return 1;
+
+	importer.updateMemoryStats();
+	printStats(importer);
+	if (trace_path && !importer.writeTrace(trace_path)) return 1;
+	return 0;
+}
+
+
+int main(int argc, char** argv)
+{
+	DefaultAllocator allocator;
+	getLogCallback().bind<logToStdout>();
+	if (!JobSystem::init(OS::getCPUsCount(), allocator))
+	{
+		fprintf(stderr, "Failed to initialize job system\n");
+		return 1;
+	}
+
+	const int res = run(allocator, argc, argv);
+
+	JobSystem::shutdown();
+	return res;
+}
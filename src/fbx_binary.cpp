@@ -0,0 +1,864 @@
+#include "fbx_binary.h"
+#include "engine/allocator.h"
+#include "engine/math.h"
+#include "parallel.h"
+#include <stdlib.h>
+#include <string.h>
+#ifdef _WIN32
+	#define WIN32_LEAN_AND_MEAN
+	#include <Windows.h>
+#else
+	#include <fcntl.h>
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <unistd.h>
+#endif
+
+
+namespace Lumix
+{
+
+
+namespace BinaryFBX
+{
+
+
+static const char MAGIC[] = "Kaydara FBX Binary  ";
+static const u32 HEADER_SIZE = 27;
+
+
+template <typename T> static T readUnaligned(const u8* ptr)
+{
+	T res;
+	memcpy(&res, ptr, sizeof(res));
+	return res;
+}
+
+
+bool MappedFile::open(const char* path)
+{
+	close();
+#ifdef _WIN32
+	HANDLE handle = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (handle == INVALID_HANDLE_VALUE) return false;
+
+	LARGE_INTEGER file_size;
+	if (!GetFileSizeEx(handle, &file_size) || file_size.QuadPart == 0)
+	{
+		CloseHandle(handle);
+		return false;
+	}
+
+	HANDLE mapping = CreateFileMappingA(handle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (!mapping)
+	{
+		CloseHandle(handle);
+		return false;
+	}
+
+	data = (const u8*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	if (!data)
+	{
+		CloseHandle(mapping);
+		CloseHandle(handle);
+		return false;
+	}
+	file_handle = handle;
+	mapping_handle = mapping;
+	size = (u64)file_size.QuadPart;
+#else
+	int fd = ::open(path, O_RDONLY);
+	if (fd < 0) return false;
+
+	struct stat st;
+	if (fstat(fd, &st) != 0 || st.st_size == 0)
+	{
+		::close(fd);
+		return false;
+	}
+
+	void* ptr = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	::close(fd);
+	if (ptr == MAP_FAILED) return false;
+
+	madvise(ptr, (size_t)st.st_size, MADV_SEQUENTIAL);
+	data = (const u8*)ptr;
+	size = (u64)st.st_size;
+#endif
+	return true;
+}
+
+
+void MappedFile::close()
+{
+	if (!data) return;
+#ifdef _WIN32
+	UnmapViewOfFile(data);
+	CloseHandle((HANDLE)mapping_handle);
+	CloseHandle((HANDLE)file_handle);
+	file_handle = nullptr;
+	mapping_handle = nullptr;
+#else
+	munmap((void*)data, (size_t)size);
+#endif
+	data = nullptr;
+	size = 0;
+}
+
+
+bool DataView::operator==(const char* rhs) const
+{
+	const u8* c = begin;
+	while (c != end && *rhs)
+	{
+		if (*c != (u8)*rhs) return false;
+		++c;
+		++rhs;
+	}
+	return c == end && *rhs == '\0';
+}
+
+
+void DataView::toString(Span<char> out) const
+{
+	if (out.length() == 0) return;
+	u32 len = minimum(length(), out.length() - 1);
+	memcpy(out.begin(), begin, len);
+	out[len] = '\0';
+}
+
+
+double ArrayView::getDouble(u32 idx) const
+{
+	switch (type)
+	{
+		case 'd': return readUnaligned<double>(data + idx * sizeof(double));
+		case 'f': return readUnaligned<float>(data + idx * sizeof(float));
+		case 'i': return readUnaligned<i32>(data + idx * sizeof(i32));
+		case 'l': return (double)readUnaligned<i64>(data + idx * sizeof(i64));
+		case 'b': return data[idx];
+	}
+	ASSERT(false);
+	return 0;
+}
+
+
+i32 ArrayView::getInt(u32 idx) const
+{
+	switch (type)
+	{
+		case 'i': return readUnaligned<i32>(data + idx * sizeof(i32));
+		case 'l': return (i32)readUnaligned<i64>(data + idx * sizeof(i64));
+		case 'd': return (i32)readUnaligned<double>(data + idx * sizeof(double));
+		case 'f': return (i32)readUnaligned<float>(data + idx * sizeof(float));
+		case 'b': return data[idx];
+	}
+	ASSERT(false);
+	return 0;
+}
+
+
+i64 ArrayView::getI64(u32 idx) const
+{
+	switch (type)
+	{
+		case 'l': return readUnaligned<i64>(data + idx * sizeof(i64));
+		case 'i': return readUnaligned<i32>(data + idx * sizeof(i32));
+		case 'd': return (i64)readUnaligned<double>(data + idx * sizeof(double));
+		case 'f': return (i64)readUnaligned<float>(data + idx * sizeof(float));
+		case 'b': return data[idx];
+	}
+	ASSERT(false);
+	return 0;
+}
+
+
+u32 Property::getElementSize() const
+{
+	switch (type)
+	{
+		case 'd':
+		case 'l': return 8;
+		case 'f':
+		case 'i': return 4;
+		case 'b': return 1;
+	}
+	return 0;
+}
+
+
+i64 Property::toI64() const
+{
+	switch (type)
+	{
+		case 'Y': return readUnaligned<i16>(data);
+		case 'C': return data[0];
+		case 'I': return readUnaligned<i32>(data);
+		case 'L': return readUnaligned<i64>(data);
+		case 'F': return (i64)readUnaligned<float>(data);
+		case 'D': return (i64)readUnaligned<double>(data);
+	}
+	return 0;
+}
+
+
+double Property::toDouble() const
+{
+	switch (type)
+	{
+		case 'F': return readUnaligned<float>(data);
+		case 'D': return readUnaligned<double>(data);
+		case 'Y': return readUnaligned<i16>(data);
+		case 'C': return data[0];
+		case 'I': return readUnaligned<i32>(data);
+		case 'L': return (double)readUnaligned<i64>(data);
+	}
+	return 0;
+}
+
+
+DataView Property::toString() const
+{
+	DataView res;
+	if (type != 'S' && type != 'R') return res;
+	res.begin = data;
+	res.end = data + count;
+	return res;
+}
+
+
+DataView Property::toObjectName() const
+{
+	DataView res = toString();
+	for (const u8* c = res.begin; c != res.end; ++c)
+	{
+		if (*c == '\0')
+		{
+			res.end = c;
+			break;
+		}
+	}
+	return res;
+}
+
+
+Document::Document(IAllocator& allocator)
+	: allocator(allocator)
+	, elements(allocator)
+	, properties(allocator)
+{
+}
+
+
+Document::~Document()
+{
+	if (arena) allocator.deallocate(arena);
+	file.close();
+}
+
+
+bool Document::open(const char* path)
+{
+	if (!file.open(path))
+	{
+		error = "Could not open file";
+		return false;
+	}
+	return parse();
+}
+
+
+void Document::gatherCompressedArrays(const Element& element, Array<i32>& out) const
+{
+	for (i32 i = element.first_property; i < element.first_property + element.property_count; ++i)
+	{
+		if (properties[i].isArray() && properties[i].encoding == 1) out.push(i);
+	}
+	for (const Element* child = getFirstChild(element); child; child = getNextSibling(*child))
+	{
+		gatherCompressedArrays(*child, out);
+	}
+}
+
+
+bool Document::inflateArrays(Span<const Element* const> elements)
+{
+	ASSERT(!arena);
+	Array<i32> compressed_arrays(allocator);
+	for (const Element* element : elements) gatherCompressedArrays(*element, compressed_arrays);
+	if (compressed_arrays.empty()) return true;
+
+	u64 arena_size = 0;
+	for (i32 idx : compressed_arrays)
+	{
+		Property& prop = properties[idx];
+		prop.arena_offset = arena_size;
+		arena_size += (prop.getByteSize() + 7) & ~(u64)7;
+	}
+	arena = (u8*)allocator.allocate((size_t)arena_size);
+
+	struct Job
+	{
+		u32 byte_length;
+		i32 property;
+	};
+	Array<Job> jobs(allocator);
+	jobs.reserve(compressed_arrays.size());
+	for (i32 idx : compressed_arrays) jobs.push({properties[idx].byte_length, idx});
+
+	// biggest arrays first, so a single huge array does not end up last on one worker
+	qsort(jobs.begin(), jobs.size(), sizeof(jobs[0]), [](const void* a, const void* b) -> int {
+		const u32 la = ((const Job*)a)->byte_length;
+		const u32 lb = ((const Job*)b)->byte_length;
+		if (la == lb) return 0;
+		return la < lb ? 1 : -1;
+	});
+
+	volatile i32 failed = 0;
+	parallelFor(jobs.size(), [&](i32 i) {
+		const Property& prop = properties[jobs[i].property];
+		if (!inflateZlib(prop.data, prop.byte_length, arena + prop.arena_offset, (u32)prop.getByteSize())) failed = 1;
+	});
+
+	if (failed)
+	{
+		error = "Failed to inflate compressed array";
+		return false;
+	}
+	for (i32 idx : compressed_arrays) properties[idx].inflated = true;
+	return true;
+}
+
+
+bool Document::parse()
+{
+	if (file.size < HEADER_SIZE || memcmp(file.data, MAGIC, sizeof(MAGIC) - 1) != 0)
+	{
+		error = "Not a binary FBX file";
+		return false;
+	}
+
+	version = readUnaligned<u32>(file.data + 23);
+	elements.reserve(4096);
+	properties.reserve(8192);
+
+	elements.emplace();
+	const u8* cursor = file.data + HEADER_SIZE;
+	i32 prev = -1;
+	for (;;)
+	{
+		i32 child;
+		if (!parseElement(cursor, child)) return false;
+		if (child < 0) break;
+
+		if (prev < 0) elements[0].first_child = child;
+		else elements[prev].next_sibling = child;
+		prev = child;
+	}
+	return true;
+}
+
+
+bool Document::parseProperty(const u8*& cursor, const u8* end)
+{
+	if (cursor >= end)
+	{
+		error = "Unexpected end of property list";
+		return false;
+	}
+
+	Property& prop = properties.emplace();
+	prop.type = (char)*cursor;
+	++cursor;
+	prop.data = cursor;
+
+	u32 size = 0;
+	switch (prop.type)
+	{
+		case 'Y': size = 2; break;
+		case 'C': size = 1; break;
+		case 'I':
+		case 'F': size = 4; break;
+		case 'D':
+		case 'L': size = 8; break;
+		case 'S':
+		case 'R':
+			if (cursor + 4 > end) break;
+			prop.count = readUnaligned<u32>(cursor);
+			prop.data = cursor + 4;
+			size = 4 + prop.count;
+			break;
+		case 'd':
+		case 'f':
+		case 'l':
+		case 'i':
+		case 'b':
+			if (cursor + 12 > end) break;
+			prop.count = readUnaligned<u32>(cursor);
+			prop.encoding = readUnaligned<u32>(cursor + 4);
+			prop.byte_length = readUnaligned<u32>(cursor + 8);
+			prop.data = cursor + 12;
+			size = 12 + prop.byte_length;
+			if (prop.getByteSize() > 0xffffFFFF)
+			{
+				error = "Array too large";
+				return false;
+			}
+			break;
+		default: error = "Unknown property type"; return false;
+	}
+
+	if (size == 0 || cursor + size > end)
+	{
+		error = "Truncated property";
+		return false;
+	}
+	cursor += size;
+	return true;
+}
+
+
+bool Document::parseElement(const u8*& cursor, i32& out_idx)
+{
+	const bool is_64bit = version >= 7500;
+	const u32 record_header_size = is_64bit ? 25 : 13;
+	const u8* file_end = file.data + file.size;
+	if (cursor + record_header_size > file_end)
+	{
+		// files without footer end right after the last top level record
+		out_idx = -1;
+		return true;
+	}
+
+	u64 end_offset, property_count, property_list_length;
+	if (is_64bit)
+	{
+		end_offset = readUnaligned<u64>(cursor);
+		property_count = readUnaligned<u64>(cursor + 8);
+		property_list_length = readUnaligned<u64>(cursor + 16);
+		cursor += 24;
+	}
+	else
+	{
+		end_offset = readUnaligned<u32>(cursor);
+		property_count = readUnaligned<u32>(cursor + 4);
+		property_list_length = readUnaligned<u32>(cursor + 8);
+		cursor += 12;
+	}
+	const u8 id_length = *cursor;
+	++cursor;
+
+	if (end_offset == 0)
+	{
+		out_idx = -1;
+		return true;
+	}
+
+	const u8* element_end = file.data + end_offset;
+	if (element_end > file_end || cursor + id_length + property_list_length > element_end)
+	{
+		error = "Invalid element size";
+		return false;
+	}
+
+	out_idx = elements.size();
+	{
+		Element& element = elements.emplace();
+		element.id.begin = cursor;
+		element.id.end = cursor + id_length;
+		element.first_property = properties.size();
+		element.property_count = (i32)property_count;
+	}
+	cursor += id_length;
+
+	const u8* properties_end = cursor + property_list_length;
+	for (u64 i = 0; i < property_count; ++i)
+	{
+		if (!parseProperty(cursor, properties_end)) return false;
+	}
+	cursor = properties_end;
+
+	i32 prev = -1;
+	while (cursor < element_end)
+	{
+		if (element_end - cursor <= record_header_size)
+		{
+			// null record terminating the children list
+			cursor = element_end;
+			break;
+		}
+
+		i32 child;
+		if (!parseElement(cursor, child)) return false;
+		if (child < 0) break;
+
+		if (prev < 0) elements[out_idx].first_child = child;
+		else elements[prev].next_sibling = child;
+		prev = child;
+	}
+	cursor = element_end;
+	return true;
+}
+
+
+const Element* Document::getFirstChild(const Element& element) const
+{
+	return element.first_child < 0 ? nullptr : &elements[element.first_child];
+}
+
+
+const Element* Document::getNextSibling(const Element& element) const
+{
+	return element.next_sibling < 0 ? nullptr : &elements[element.next_sibling];
+}
+
+
+const Element* Document::findChild(const Element& element, const char* id) const
+{
+	for (const Element* child = getFirstChild(element); child; child = getNextSibling(*child))
+	{
+		if (child->id == id) return child;
+	}
+	return nullptr;
+}
+
+
+const Property* Document::getProperty(const Element& element, int idx) const
+{
+	if (idx >= element.property_count) return nullptr;
+	return &properties[element.first_property + idx];
+}
+
+
+bool Document::getArray(const Property& prop, ArrayView& out)
+{
+	if (!prop.isArray()) return false;
+
+	out.type = prop.type;
+	out.count = prop.count;
+	if (prop.encoding == 0)
+	{
+		if (prop.byte_length < prop.getByteSize()) return false;
+		out.data = prop.data;
+		return true;
+	}
+	if (prop.encoding != 1 || !prop.inflated) return false;
+
+	out.data = arena + prop.arena_offset;
+	return true;
+}
+
+
+namespace
+{
+
+
+struct Huffman
+{
+	static const u32 FAST_BITS = 10;
+
+	bool build(const u8* lengths, u32 count);
+
+	u16 counts[16];
+	u16 symbols[288];
+	// (symbol << 4) | code length, 0 if the code is longer than FAST_BITS
+	u16 fast[1 << FAST_BITS];
+};
+
+
+struct Inflater
+{
+	u32 getBits(u32 count)
+	{
+		refill();
+		u32 res = bit_buf & ((1u << count) - 1);
+		bit_buf >>= count;
+		bit_count -= count;
+		return res;
+	}
+
+	void refill()
+	{
+		while (bit_count <= 24)
+		{
+			const u32 byte = src < src_end ? *src : 0;
+			++src;
+			bit_buf |= byte << bit_count;
+			bit_count += 8;
+		}
+	}
+
+	int decode(const Huffman& huffman)
+	{
+		refill();
+		const u16 entry = huffman.fast[bit_buf & ((1 << Huffman::FAST_BITS) - 1)];
+		if (entry)
+		{
+			const u32 len = entry & 0xf;
+			bit_buf >>= len;
+			bit_count -= len;
+			return entry >> 4;
+		}
+
+		int code = 0;
+		int first = 0;
+		int index = 0;
+		u32 buf = bit_buf;
+		for (u32 len = 1; len < 16; ++len)
+		{
+			code |= buf & 1;
+			buf >>= 1;
+			const int count = huffman.counts[len];
+			if (code - first < count)
+			{
+				bit_buf >>= len;
+				bit_count -= len;
+				return huffman.symbols[index + code - first];
+			}
+			index += count;
+			first += count;
+			first <<= 1;
+			code <<= 1;
+		}
+		return -1;
+	}
+
+	// bytes read ahead past the end of input are zeros, it's an error only if they are consumed
+	bool isExhausted() const { return src - bit_count / 8 > src_end; }
+
+	bool stored();
+	bool codes(const Huffman& lengths, const Huffman& distances);
+	bool fixed();
+	bool dynamic();
+
+	const u8* src;
+	const u8* src_end;
+	u8* dst;
+	u8* dst_begin;
+	u8* dst_end;
+	u32 bit_buf = 0;
+	u32 bit_count = 0;
+};
+
+
+bool Huffman::build(const u8* lengths, u32 count)
+{
+	memset(counts, 0, sizeof(counts));
+	memset(fast, 0, sizeof(fast));
+	for (u32 i = 0; i < count; ++i) ++counts[lengths[i]];
+	if (counts[0] == count) return true;
+
+	int left = 1;
+	for (u32 len = 1; len < 16; ++len)
+	{
+		left <<= 1;
+		left -= counts[len];
+		if (left < 0) return false;
+	}
+
+	u16 offsets[16];
+	offsets[1] = 0;
+	for (u32 len = 1; len < 15; ++len) offsets[len + 1] = offsets[len] + counts[len];
+	for (u32 i = 0; i < count; ++i)
+	{
+		if (lengths[i] != 0) symbols[offsets[lengths[i]]++] = (u16)i;
+	}
+
+	u32 code = 0;
+	u32 index = 0;
+	for (u32 len = 1; len < 16; ++len)
+	{
+		for (u32 i = 0; i < counts[len]; ++i, ++code, ++index)
+		{
+			if (len > FAST_BITS) continue;
+
+			u32 reversed = 0;
+			for (u32 b = 0; b < len; ++b) reversed |= ((code >> b) & 1) << (len - 1 - b);
+			for (u32 k = reversed; k < (1u << FAST_BITS); k += 1 << len)
+			{
+				fast[k] = u16((symbols[index] << 4) | len);
+			}
+		}
+		code <<= 1;
+	}
+	return true;
+}
+
+
+bool Inflater::stored()
+{
+	// drop the remaining bits of the current byte, and give back the bytes read ahead
+	bit_buf >>= bit_count & 7;
+	bit_count -= bit_count & 7;
+	src -= bit_count / 8;
+	bit_buf = 0;
+	bit_count = 0;
+
+	if (src + 4 > src_end) return false;
+	const u32 len = src[0] | (src[1] << 8);
+	const u32 nlen = src[2] | (src[3] << 8);
+	if (len != (~nlen & 0xffff)) return false;
+	src += 4;
+
+	if (src + len > src_end || dst + len > dst_end) return false;
+	memcpy(dst, src, len);
+	dst += len;
+	src += len;
+	return true;
+}
+
+
+bool Inflater::codes(const Huffman& lengths, const Huffman& distances)
+{
+	static const u16 LENGTH_BASE[] = {
+		3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+	static const u8 LENGTH_EXTRA[] = {
+		0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+	static const u16 DIST_BASE[] = {1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025,
+		1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577};
+	static const u8 DIST_EXTRA[] = {
+		0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+
+	for (;;)
+	{
+		int symbol = decode(lengths);
+		if (symbol < 0 || isExhausted()) return false;
+		if (symbol < 256)
+		{
+			if (dst == dst_end) return false;
+			*dst = (u8)symbol;
+			++dst;
+			continue;
+		}
+		if (symbol == 256) return true;
+
+		symbol -= 257;
+		if (symbol >= 29) return false;
+		const u32 len = LENGTH_BASE[symbol] + getBits(LENGTH_EXTRA[symbol]);
+
+		const int dist_symbol = decode(distances);
+		if (dist_symbol < 0 || dist_symbol >= 30) return false;
+		const u32 dist = DIST_BASE[dist_symbol] + getBits(DIST_EXTRA[dist_symbol]);
+
+		if (dist > u32(dst - dst_begin) || dst + len > dst_end) return false;
+		const u8* from = dst - dist;
+		for (u32 i = 0; i < len; ++i) dst[i] = from[i];
+		dst += len;
+	}
+}
+
+
+bool Inflater::fixed()
+{
+	static Huffman lengths;
+	static Huffman distances;
+	static bool initialized = [](){
+		u8 tmp[288];
+		u32 i = 0;
+		for (; i < 144; ++i) tmp[i] = 8;
+		for (; i < 256; ++i) tmp[i] = 9;
+		for (; i < 280; ++i) tmp[i] = 7;
+		for (; i < 288; ++i) tmp[i] = 8;
+		lengths.build(tmp, 288);
+		for (i = 0; i < 30; ++i) tmp[i] = 5;
+		distances.build(tmp, 30);
+		return true;
+	}();
+	(void)initialized;
+
+	return codes(lengths, distances);
+}
+
+
+bool Inflater::dynamic()
+{
+	static const u8 ORDER[] = {16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15};
+
+	const u32 nlen = getBits(5) + 257;
+	const u32 ndist = getBits(5) + 1;
+	const u32 ncode = getBits(4) + 4;
+	if (nlen > 286 || ndist > 30) return false;
+
+	u8 lengths[320] = {};
+	for (u32 i = 0; i < ncode; ++i) lengths[ORDER[i]] = (u8)getBits(3);
+
+	Huffman code_lengths;
+	if (!code_lengths.build(lengths, 19)) return false;
+
+	u32 index = 0;
+	while (index < nlen + ndist)
+	{
+		int symbol = decode(code_lengths);
+		if (symbol < 0 || isExhausted()) return false;
+		if (symbol < 16)
+		{
+			lengths[index++] = (u8)symbol;
+			continue;
+		}
+
+		u8 len = 0;
+		u32 repeat;
+		if (symbol == 16)
+		{
+			if (index == 0) return false;
+			len = lengths[index - 1];
+			repeat = 3 + getBits(2);
+		}
+		else if (symbol == 17) repeat = 3 + getBits(3);
+		else repeat = 11 + getBits(7);
+
+		if (index + repeat > nlen + ndist) return false;
+		while (repeat--) lengths[index++] = len;
+	}
+	if (lengths[256] == 0) return false;
+
+	Huffman lengths_huffman;
+	Huffman distances_huffman;
+	if (!lengths_huffman.build(lengths, nlen)) return false;
+	if (!distances_huffman.build(lengths + nlen, ndist)) return false;
+
+	return codes(lengths_huffman, distances_huffman);
+}
+
+
+} // anonymous namespace
+
+
+bool inflateZlib(const u8* src, u32 src_size, u8* dst, u32 dst_size)
+{
+	if (src_size < 2) return false;
+	const u8 cmf = src[0];
+	const u8 flg = src[1];
+	if ((cmf & 0xf) != 8 || ((cmf << 8) | flg) % 31 != 0 || (flg & 0x20)) return false;
+
+	Inflater inflater;
+	inflater.src = src + 2;
+	inflater.src_end = src + src_size;
+	inflater.dst = dst;
+	inflater.dst_begin = dst;
+	inflater.dst_end = dst + dst_size;
+
+	bool last;
+	do
+	{
+		last = inflater.getBits(1) != 0;
+		const u32 type = inflater.getBits(2);
+		bool res;
+		switch (type)
+		{
+			case 0: res = inflater.stored(); break;
+			case 1: res = inflater.fixed(); break;
+			case 2: res = inflater.dynamic(); break;
+			default: res = false; break;
+		}
+		if (!res || inflater.isExhausted()) return false;
+	} while (!last);
+
+	return inflater.dst == inflater.dst_end;
+}
+
+
+} // namespace BinaryFBX
+
+
+} // namespace Lumix
@@ -0,0 +1,129 @@
+#pragma once
+
+
+#include "engine/array.h"
+#include "engine/lumix.h"
+
+
+namespace Lumix
+{
+
+
+namespace BinaryFBX
+{
+
+
+struct MappedFile
+{
+	bool open(const char* path);
+	void close();
+
+	const u8* data = nullptr;
+	u64 size = 0;
+#ifdef _WIN32
+	void* file_handle = nullptr;
+	void* mapping_handle = nullptr;
+#endif
+};
+
+
+struct DataView
+{
+	bool operator==(const char* rhs) const;
+	void toString(Span<char> out) const;
+	u32 length() const { return u32(end - begin); }
+
+	const u8* begin = nullptr;
+	const u8* end = nullptr;
+};
+
+
+// references array data in place - either directly in the mapped file or in inflated memory
+struct ArrayView
+{
+	double getDouble(u32 idx) const;
+	float getFloat(u32 idx) const { return (float)getDouble(idx); }
+	i32 getInt(u32 idx) const;
+	i64 getI64(u32 idx) const;
+
+	const u8* data = nullptr;
+	u32 count = 0;
+	char type = 0;
+};
+
+
+struct Property
+{
+	bool isArray() const { return type == 'd' || type == 'f' || type == 'i' || type == 'l' || type == 'b'; }
+	u32 getElementSize() const;
+	// of the uncompressed array, parsing rejects arrays which do not fit in u32
+	u64 getByteSize() const { return (u64)count * getElementSize(); }
+	i64 toI64() const;
+	double toDouble() const;
+	DataView toString() const;
+	// "Name\x00\x01Class" -> "Name"
+	DataView toObjectName() const;
+
+	char type = 0;
+	const u8* data = nullptr;
+	u32 count = 0;
+	u32 encoding = 0;
+	u32 byte_length = 0;
+	u64 arena_offset = 0;
+	bool inflated = false;
+};
+
+
+struct Element
+{
+	DataView id;
+	i32 first_property = 0;
+	i32 property_count = 0;
+	i32 first_child = -1;
+	i32 next_sibling = -1;
+};
+
+
+struct Document
+{
+	explicit Document(IAllocator& allocator);
+	~Document();
+
+	// compressed arrays stay compressed and getArray fails for them until they are inflated
+	bool open(const char* path);
+	// inflates the compressed arrays in the subtrees of elements in parallel, can be called once
+	bool inflateArrays(Span<const Element* const> elements);
+	const char* getError() const { return error; }
+	u32 getVersion() const { return version; }
+
+	const Element& getRoot() const { return elements[0]; }
+	const Element* getFirstChild(const Element& element) const;
+	const Element* getNextSibling(const Element& element) const;
+	const Element* findChild(const Element& element, const char* id) const;
+	const Property* getProperty(const Element& element, int idx) const;
+	bool getArray(const Property& prop, ArrayView& out);
+
+private:
+	bool parse();
+	bool parseElement(const u8*& cursor, i32& out_idx);
+	bool parseProperty(const u8*& cursor, const u8* end);
+	void gatherCompressedArrays(const Element& element, Array<i32>& out) const;
+
+	IAllocator& allocator;
+	MappedFile file;
+	Array<Element> elements;
+	Array<Property> properties;
+	// all inflated arrays are in this single block
+	u8* arena = nullptr;
+	const char* error = nullptr;
+	u32 version = 0;
+};
+
+
+bool inflateZlib(const u8* src, u32 src_size, u8* dst, u32 dst_size);
+
+
+} // namespace BinaryFBX
+
+
+} // namespace Lumix
@@ -0,0 +1,4588 @@
+#include "fbx_importer.h"
+#include "animation/animation.h"
+#include "engine/crc32.h"
+#include "engine/hash_map.h"
+#include "engine/log.h"
+#include "engine/path.h"
+#include "engine/stream.h"
+#include "renderer/model.h"
+#include "fbx_binary.h"
+#include "fbx_memory.h"
+#include "mesh_optimizer.h"
+#include "parallel.h"
+#include "physics_cooker.h"
+#include "texture_compressor.h"
+#ifdef _WIN32
+	#define WIN32_LEAN_AND_MEAN
+	#define PSAPI_VERSION 2
+	#include <Windows.h>
+	#include <Psapi.h>
+#else
+	#include <sys/resource.h>
+#endif
+
+
+namespace Lumix
+{
+
+
+// matches Mesh::AttributeSemantic
+enum AttributeSemantic : i32
+{
+	SEMANTIC_POSITION = 0,
+	SEMANTIC_NORMAL = 1,
+	SEMANTIC_TANGENT = 2,
+	SEMANTIC_INDICES = 6,
+	SEMANTIC_WEIGHTS = 7,
+	SEMANTIC_TEXCOORD0 = 8
+};
+
+
+// model flag - every attribute is followed by its type, component count and normalized flag
+// and every mesh by its position and uv dequantization ranges
+static const u32 ATTRIBUTE_TYPES_FLAG = 1 << 1;
+// model flag - blend shapes of every mesh follow the LODs
+static const u32 BLEND_SHAPES_FLAG = 1 << 2;
+// blend shape deltas below these are exporter noise, distance is relative to the mesh radius
+static const float BLEND_SHAPE_MIN_DISTANCE = 1e-4f;
+static const float BLEND_SHAPE_MIN_NORMAL_DELTA = 1e-2f;
+// relative, bind poses of the same skeleton in different sources differ by exporter noise
+static const double BIND_POSE_TOLERANCE = 1e-3;
+static const int MAX_ATTRIBUTES = 8;
+// bump when the same sources and options produce different output
+static const u32 CACHE_VERSION = 10;
+static const char* CACHE_INDEX_FILENAME = "index.txt";
+// lane and nesting level of stages on the current thread
+static thread_local u32 stage_thread = 0;
+static thread_local u32 stage_depth = 0;
+// animation with quantized keys and delta coded frames, followed by flags
+static const u32 ANIMATION_VERSION_QUANTIZED = 4;
+// animation flag - rotations are packed in 32 instead of 48 bits
+static const u32 ANIMATION_ROTATIONS_32BIT_FLAG = 1 << 0;
+// same as the quantized version with flags for any key format, a root motion track follows the bones
+// if there is a root motion bone, only used by root motion and additive animations
+static const u32 ANIMATION_VERSION_FLAGS = 5;
+// animation flag - keys are not quantized, like in version 3
+static const u32 ANIMATION_FLOAT_KEYS_FLAG = 1 << 1;
+// animation flag - keys are local space deltas from a reference, bones which are not in the file are identity
+static const u32 ANIMATION_ADDITIVE_FLAG = 1 << 2;
+// 'LPHY', cooked collision of meshes flagged import_physics
+static const u32 PHYSICS_MAGIC = 0x4C504859;
+static const u32 PHYSICS_VERSION = 1;
+
+
+// 64-bit FNV-1a
+struct CacheHasher
+{
+	void update(const void* data, u64 size)
+	{
+		const u8* bytes = (const u8*)data;
+		for (u64 i = 0; i < size; ++i) hash = (hash ^ bytes[i]) * 0x100000001b3;
+	}
+
+	template <typename T> void update(const T& value) { update(&value, sizeof(value)); }
+	void updateString(const char* str) { update(str, stringLength(str) + 1); }
+
+	u64 hash = 0xcbf29ce484222325;
+};
+
+
+// replaces the SDK parser, not the scene: the document is parsed in place, but control points, layer
+// elements and curve keys are copied into FbxScene objects, so the rest of the importer is shared
+struct NativeSceneLoader
+{
+	enum class ObjectType
+	{
+		MODEL,
+		GEOMETRY,
+		MATERIAL,
+		TEXTURE,
+		SKIN,
+		CLUSTER,
+		ANIMATION_STACK,
+		ANIMATION_LAYER,
+		ANIMATION_CURVE_NODE,
+		ANIMATION_CURVE,
+		OTHER
+	};
+
+	struct Object
+	{
+		ObjectType type = ObjectType::OTHER;
+		const BinaryFBX::Element* element = nullptr;
+		FbxObject* fbx = nullptr;
+		// animation curve node
+		FbxNode* target = nullptr;
+		BinaryFBX::DataView target_property;
+		FbxAnimLayer* layer = nullptr;
+		// animation curve
+		u64 curve_node = 0;
+		BinaryFBX::DataView channel;
+	};
+
+	NativeSceneLoader(BinaryFBX::Document& doc, FbxScene& scene, IAllocator& allocator)
+		: doc(doc)
+		, scene(scene)
+		, allocator(allocator)
+		, objects(allocator)
+		, curves(allocator)
+	{
+	}
+
+
+	template <typename T> static T* cast(const Object* obj, ObjectType type)
+	{
+		return obj && obj->type == type ? static_cast<T*>(obj->fbx) : nullptr;
+	}
+
+
+	static FbxLayerElement::EMappingMode getMappingMode(const BinaryFBX::DataView& str)
+	{
+		if (str == "ByPolygonVertex") return FbxLayerElement::eByPolygonVertex;
+		if (str == "ByPolygon") return FbxLayerElement::eByPolygon;
+		if (str == "ByVertice" || str == "ByVertex") return FbxLayerElement::eByControlPoint;
+		if (str == "ByEdge") return FbxLayerElement::eByEdge;
+		if (str == "AllSame") return FbxLayerElement::eAllSame;
+		return FbxLayerElement::eNone;
+	}
+
+
+	static FbxLayerElement::EReferenceMode getReferenceMode(const BinaryFBX::DataView& str)
+	{
+		if (str == "IndexToDirect") return FbxLayerElement::eIndexToDirect;
+		if (str == "Index") return FbxLayerElement::eIndex;
+		return FbxLayerElement::eDirect;
+	}
+
+
+	static void toFbx(const BinaryFBX::ArrayView& data, u32 idx, FbxVector4& out)
+	{
+		out.Set(data.getDouble(idx * 3), data.getDouble(idx * 3 + 1), data.getDouble(idx * 3 + 2));
+	}
+
+
+	static void toFbx(const BinaryFBX::ArrayView& data, u32 idx, FbxVector2& out)
+	{
+		out.Set(data.getDouble(idx * 2), data.getDouble(idx * 2 + 1));
+	}
+
+
+	static u32 getComponentCount(const FbxVector4&) { return 3; }
+	static u32 getComponentCount(const FbxVector2&) { return 2; }
+
+
+	const BinaryFBX::Property* getChildProperty(const BinaryFBX::Element& element, const char* id, int idx = 0) const
+	{
+		const BinaryFBX::Element* child = doc.findChild(element, id);
+		return child ? doc.getProperty(*child, idx) : nullptr;
+	}
+
+
+	bool getChildArray(const BinaryFBX::Element& element, const char* id, BinaryFBX::ArrayView& out) const
+	{
+		const BinaryFBX::Property* prop = getChildProperty(element, id);
+		return prop && doc.getArray(*prop, out);
+	}
+
+
+	BinaryFBX::DataView getChildString(const BinaryFBX::Element& element, const char* id) const
+	{
+		const BinaryFBX::Property* prop = getChildProperty(element, id);
+		return prop ? prop->toString() : BinaryFBX::DataView();
+	}
+
+
+	bool getMatrix(const BinaryFBX::Element& element, const char* id, FbxAMatrix& out) const
+	{
+		BinaryFBX::ArrayView data;
+		if (!getChildArray(element, id, data) || data.count != 16) return false;
+		for (u32 i = 0; i < 16; ++i) out.mData[i / 4].mData[i % 4] = data.getDouble(i);
+		return true;
+	}
+
+
+	template <typename T>
+	bool loadLayerElement(const BinaryFBX::Element& element,
+		FbxLayerElementTemplate<T>& out,
+		const char* data_id,
+		const char* index_id) const
+	{
+		out.SetMappingMode(getMappingMode(getChildString(element, "MappingInformationType")));
+		out.SetReferenceMode(getReferenceMode(getChildString(element, "ReferenceInformationType")));
+
+		BinaryFBX::ArrayView data;
+		if (!getChildArray(element, data_id, data)) return false;
+
+		T value;
+		const u32 count = data.count / getComponentCount(value);
+		auto& direct = out.GetDirectArray();
+		direct.Resize(count);
+		for (u32 i = 0; i < count; ++i)
+		{
+			toFbx(data, i, value);
+			direct.SetAt(i, value);
+		}
+
+		if (out.GetReferenceMode() == FbxLayerElement::eDirect) return true;
+
+		BinaryFBX::ArrayView indices;
+		if (!getChildArray(element, index_id, indices)) return false;
+		auto& index_array = out.GetIndexArray();
+		index_array.Resize(indices.count);
+		for (u32 i = 0; i < indices.count; ++i) index_array.SetAt(i, indices.getInt(i));
+		return true;
+	}
+
+
+	void loadProperties(const BinaryFBX::Element& element, FbxObject& object) const
+	{
+		const BinaryFBX::Element* props = doc.findChild(element, "Properties70");
+		if (!props) return;
+
+		for (const BinaryFBX::Element* p = doc.getFirstChild(*props); p; p = doc.getNextSibling(*p))
+		{
+			if (p->property_count < 5) continue;
+
+			char name[128];
+			doc.getProperty(*p, 0)->toString().toString(Span(name));
+			FbxProperty prop = object.FindProperty(name);
+			if (!prop.IsValid()) continue;
+
+			auto getDouble = [&](int idx) { return doc.getProperty(*p, 4 + idx)->toDouble(); };
+			switch (prop.GetPropertyDataType().GetType())
+			{
+				case eFbxBool: prop.Set(doc.getProperty(*p, 4)->toI64() != 0); break;
+				case eFbxInt:
+				case eFbxEnum: prop.Set((int)doc.getProperty(*p, 4)->toI64()); break;
+				case eFbxFloat: prop.Set((float)getDouble(0)); break;
+				case eFbxDouble: prop.Set(getDouble(0)); break;
+				case eFbxDouble3:
+					if (p->property_count >= 7) prop.Set(FbxDouble3(getDouble(0), getDouble(1), getDouble(2)));
+					break;
+				case eFbxTime:
+				{
+					FbxTime time;
+					time.Set(doc.getProperty(*p, 4)->toI64());
+					prop.Set(time);
+					break;
+				}
+				default: break;
+			}
+		}
+	}
+
+
+	FbxMesh* loadGeometry(const BinaryFBX::Element& element, const char* name) const
+	{
+		BinaryFBX::ArrayView vertices;
+		BinaryFBX::ArrayView polygon_indices;
+		if (!getChildArray(element, "Vertices", vertices)) return nullptr;
+		if (!getChildArray(element, "PolygonVertexIndex", polygon_indices)) return nullptr;
+
+		FbxMesh* mesh = FbxMesh::Create(&scene, name);
+		const u32 cp_count = vertices.count / 3;
+		mesh->InitControlPoints(cp_count);
+		FbxVector4* control_points = mesh->GetControlPoints();
+		for (u32 i = 0; i < cp_count; ++i) toFbx(vertices, i, control_points[i]);
+
+		mesh->ReservePolygonVertexCount(polygon_indices.count);
+		bool in_polygon = false;
+		for (u32 i = 0; i < polygon_indices.count; ++i)
+		{
+			int idx = polygon_indices.getInt(i);
+			const bool is_last = idx < 0;
+			if (is_last) idx = ~idx;
+			if (!in_polygon) mesh->BeginPolygon();
+			mesh->AddPolygon(idx);
+			in_polygon = !is_last;
+			if (is_last) mesh->EndPolygon();
+		}
+		if (in_polygon) mesh->EndPolygon();
+
+		for (const BinaryFBX::Element* child = doc.getFirstChild(element); child; child = doc.getNextSibling(*child))
+		{
+			if (child->id == "LayerElementNormal")
+			{
+				loadLayerElement(*child, *mesh->CreateElementNormal(), "Normals", "NormalsIndex");
+			}
+			else if (child->id == "LayerElementUV")
+			{
+				char uv_set[128];
+				getChildString(*child, "Name").toString(Span(uv_set));
+				loadLayerElement(*child, *mesh->CreateElementUV(uv_set), "UV", "UVIndex");
+			}
+			else if (child->id == "LayerElementMaterial")
+			{
+				BinaryFBX::ArrayView indices;
+				if (!getChildArray(*child, "Materials", indices)) continue;
+
+				FbxGeometryElementMaterial* material = mesh->CreateElementMaterial();
+				material->SetMappingMode(getMappingMode(getChildString(*child, "MappingInformationType")));
+				material->SetReferenceMode(FbxLayerElement::eIndexToDirect);
+				auto& index_array = material->GetIndexArray();
+				index_array.Resize(indices.count);
+				for (u32 i = 0; i < indices.count; ++i) index_array.SetAt(i, indices.getInt(i));
+			}
+		}
+		return mesh;
+	}
+
+
+	FbxCluster* loadCluster(const BinaryFBX::Element& element) const
+	{
+		FbxCluster* cluster = FbxCluster::Create(&scene, "");
+		cluster->SetLinkMode(FbxCluster::eNormalize);
+
+		BinaryFBX::ArrayView indices;
+		BinaryFBX::ArrayView weights;
+		if (getChildArray(element, "Indexes", indices) && getChildArray(element, "Weights", weights))
+		{
+			const u32 count = minimum(indices.count, weights.count);
+			for (u32 i = 0; i < count; ++i) cluster->AddControlPointIndex(indices.getInt(i), weights.getDouble(i));
+		}
+
+		FbxAMatrix mtx;
+		if (getMatrix(element, "Transform", mtx)) cluster->SetTransformMatrix(mtx);
+		if (getMatrix(element, "TransformLink", mtx)) cluster->SetTransformLinkMatrix(mtx);
+		return cluster;
+	}
+
+
+	FbxNode* loadModel(const BinaryFBX::Element& element, const char* name, const BinaryFBX::DataView& subclass) const
+	{
+		FbxNode* node = FbxNode::Create(&scene, name);
+		if (subclass == "LimbNode" || subclass == "Limb" || subclass == "Root")
+		{
+			FbxSkeleton* skeleton = FbxSkeleton::Create(&scene, name);
+			skeleton->SetSkeletonType(subclass == "Root" ? FbxSkeleton::eRoot : FbxSkeleton::eLimbNode);
+			node->SetNodeAttribute(skeleton);
+		}
+		else if (subclass == "Null")
+		{
+			node->SetNodeAttribute(FbxNull::Create(&scene, name));
+		}
+		loadProperties(element, *node);
+		return node;
+	}
+
+
+	void loadCurve(const Object& curve)
+	{
+		auto iter = objects.find(curve.curve_node);
+		if (!iter.isValid()) return;
+
+		const Object& curve_node = iter.value();
+		if (!curve_node.target || !curve_node.layer || curve.channel.length() < 3) return;
+
+		char property_name[64];
+		curve_node.target_property.toString(Span(property_name));
+		FbxProperty prop = curve_node.target->FindProperty(property_name);
+		if (!prop.IsValid()) return;
+
+		// "d|X" -> "X"
+		char channel[16];
+		BinaryFBX::DataView channel_name = curve.channel;
+		channel_name.begin += 2;
+		channel_name.toString(Span(channel));
+
+		BinaryFBX::ArrayView times;
+		BinaryFBX::ArrayView values;
+		if (!getChildArray(*curve.element, "KeyTime", times)) return;
+		if (!getChildArray(*curve.element, "KeyValueFloat", values)) return;
+
+		FbxAnimCurve* fbx_curve = prop.GetCurve(curve_node.layer, channel, true);
+		if (!fbx_curve) return;
+
+		// attributes are shared by runs of keys, KeyAttrRefCount is the length of each run
+		// every attribute has 4 floats - right slope, next left slope, two 16-bit weights and velocity
+		BinaryFBX::ArrayView attr_flags;
+		BinaryFBX::ArrayView attr_data;
+		BinaryFBX::ArrayView attr_ref_counts;
+		const bool has_attrs = getChildArray(*curve.element, "KeyAttrFlags", attr_flags)
+							   && getChildArray(*curve.element, "KeyAttrDataFloat", attr_data)
+							   && getChildArray(*curve.element, "KeyAttrRefCount", attr_ref_counts)
+							   && attr_data.count >= attr_flags.count * 4 && attr_ref_counts.count >= attr_flags.count;
+
+		static const u32 INTERPOLATION_MASK = 0x0000000e;
+		static const u32 TANGENT_MASK = 0x00007f00;
+		static const u32 WEIGHTED_MASK = 0x03000000;
+		const u32 count = minimum(times.count, values.count);
+		u32 attr = 0;
+		u32 attr_keys = 0;
+		fbx_curve->KeyModifyBegin();
+		for (u32 i = 0; i < count; ++i)
+		{
+			FbxTime time;
+			time.Set(times.getI64(i));
+			const int key = fbx_curve->KeyAdd(time);
+			if (!has_attrs)
+			{
+				fbx_curve->KeySet(key, time, values.getFloat(i), FbxAnimCurveDef::eInterpolationCubic);
+				continue;
+			}
+
+			while (attr + 1 < attr_flags.count && attr_keys >= (u32)attr_ref_counts.getInt(attr))
+			{
+				++attr;
+				attr_keys = 0;
+			}
+			++attr_keys;
+
+			const u32 flags = (u32)attr_flags.getInt(attr);
+			const float weights_bits = attr_data.getFloat(attr * 4 + 2);
+			u32 weights;
+			memcpy(&weights, &weights_bits, sizeof(weights));
+			fbx_curve->KeySet(key,
+				time,
+				values.getFloat(i),
+				(FbxAnimCurveDef::EInterpolationType)(flags & INTERPOLATION_MASK),
+				(FbxAnimCurveDef::ETangentMode)(flags & TANGENT_MASK),
+				attr_data.getFloat(attr * 4),
+				attr_data.getFloat(attr * 4 + 1),
+				(FbxAnimCurveDef::EWeightedMode)(flags & WEIGHTED_MASK),
+				(weights & 0xffff) / 9999.0f,
+				(weights >> 16) / 9999.0f);
+			if ((flags & INTERPOLATION_MASK) == FbxAnimCurveDef::eInterpolationConstant)
+			{
+				fbx_curve->KeySetConstantMode(key, (FbxAnimCurveDef::EConstantMode)(flags & TANGENT_MASK));
+			}
+		}
+		fbx_curve->KeyModifyEnd();
+	}
+
+
+	void loadGlobalSettings()
+	{
+		const BinaryFBX::Element* settings = doc.findChild(doc.getRoot(), "GlobalSettings");
+		const BinaryFBX::Element* props = settings ? doc.findChild(*settings, "Properties70") : nullptr;
+		if (!props) return;
+
+		FbxGlobalSettings& global_settings = scene.GetGlobalSettings();
+		FbxTime span_start, span_stop;
+		for (const BinaryFBX::Element* p = doc.getFirstChild(*props); p; p = doc.getNextSibling(*p))
+		{
+			if (p->property_count < 5) continue;
+
+			const BinaryFBX::DataView name = doc.getProperty(*p, 0)->toString();
+			const BinaryFBX::Property& value = *doc.getProperty(*p, 4);
+			if (name == "TimeMode") global_settings.SetTimeMode((FbxTime::EMode)value.toI64());
+			else if (name == "CustomFrameRate") global_settings.SetCustomFrameRate(value.toDouble());
+			else if (name == "UnitScaleFactor") global_settings.SetSystemUnit(FbxSystemUnit(value.toDouble()));
+			else if (name == "TimeSpanStart") span_start.Set(value.toI64());
+			else if (name == "TimeSpanStop") span_stop.Set(value.toI64());
+		}
+		global_settings.SetTimelineDefaultTimeSpan(FbxTimeSpan(span_start, span_stop));
+	}
+
+
+	void loadTakes()
+	{
+		const BinaryFBX::Element* takes = doc.findChild(doc.getRoot(), "Takes");
+		if (!takes) return;
+
+		for (const BinaryFBX::Element* take = doc.getFirstChild(*takes); take; take = doc.getNextSibling(*take))
+		{
+			if (!(take->id == "Take") || take->property_count < 1) continue;
+
+			char name[128];
+			doc.getProperty(*take, 0)->toString().toString(Span(name));
+			FbxTakeInfo info;
+			info.mName = name;
+
+			auto getSpan = [&](const char* id) {
+				const BinaryFBX::Element* el = doc.findChild(*take, id);
+				FbxTime start, stop;
+				if (el && el->property_count >= 2)
+				{
+					start.Set(doc.getProperty(*el, 0)->toI64());
+					stop.Set(doc.getProperty(*el, 1)->toI64());
+				}
+				return FbxTimeSpan(start, stop);
+			};
+			info.mLocalTimeSpan = getSpan("LocalTime");
+			info.mReferenceTimeSpan = getSpan("ReferenceTime");
+			scene.SetTakeInfo(info);
+		}
+	}
+
+
+	bool loadObjects()
+	{
+		const BinaryFBX::Element* objects_element = doc.findChild(doc.getRoot(), "Objects");
+		if (!objects_element) return false;
+
+		for (const BinaryFBX::Element* el = doc.getFirstChild(*objects_element); el; el = doc.getNextSibling(*el))
+		{
+			if (el->property_count < 3) continue;
+
+			Object obj;
+			obj.element = el;
+			const u64 id = (u64)doc.getProperty(*el, 0)->toI64();
+			char name[256];
+			doc.getProperty(*el, 1)->toObjectName().toString(Span(name));
+			const BinaryFBX::DataView subclass = doc.getProperty(*el, 2)->toString();
+
+			if (el->id == "Model")
+			{
+				obj.type = ObjectType::MODEL;
+				obj.fbx = loadModel(*el, name, subclass);
+			}
+			else if (el->id == "Geometry" && subclass == "Mesh")
+			{
+				obj.type = ObjectType::GEOMETRY;
+				obj.fbx = loadGeometry(*el, name);
+				if (!obj.fbx) return false;
+			}
+			else if (el->id == "Material")
+			{
+				obj.type = ObjectType::MATERIAL;
+				FbxSurfaceMaterial* material;
+				if (getChildString(*el, "ShadingModel") == "lambert") material = FbxSurfaceLambert::Create(&scene, name);
+				else material = FbxSurfacePhong::Create(&scene, name);
+				loadProperties(*el, *material);
+				obj.fbx = material;
+			}
+			else if (el->id == "Texture")
+			{
+				obj.type = ObjectType::TEXTURE;
+				FbxFileTexture* texture = FbxFileTexture::Create(&scene, name);
+				char path[MAX_PATH_LENGTH];
+				getChildString(*el, "FileName").toString(Span(path));
+				texture->SetFileName(path);
+				getChildString(*el, "RelativeFilename").toString(Span(path));
+				texture->SetRelativeFileName(path);
+				obj.fbx = texture;
+			}
+			else if (el->id == "Deformer" && subclass == "Skin")
+			{
+				obj.type = ObjectType::SKIN;
+				obj.fbx = FbxSkin::Create(&scene, name);
+			}
+			else if (el->id == "Deformer" && subclass == "Cluster")
+			{
+				obj.type = ObjectType::CLUSTER;
+				obj.fbx = loadCluster(*el);
+			}
+			else if (el->id == "AnimationStack")
+			{
+				obj.type = ObjectType::ANIMATION_STACK;
+				FbxAnimStack* stack = FbxAnimStack::Create(&scene, name);
+				loadProperties(*el, *stack);
+				obj.fbx = stack;
+			}
+			else if (el->id == "AnimationLayer")
+			{
+				obj.type = ObjectType::ANIMATION_LAYER;
+				obj.fbx = FbxAnimLayer::Create(&scene, name);
+			}
+			else if (el->id == "AnimationCurveNode")
+			{
+				obj.type = ObjectType::ANIMATION_CURVE_NODE;
+			}
+			else if (el->id == "AnimationCurve")
+			{
+				obj.type = ObjectType::ANIMATION_CURVE;
+				curves.push(id);
+			}
+			else
+			{
+				continue;
+			}
+			objects.insert(id, obj);
+		}
+		return true;
+	}
+
+
+	void loadConnections()
+	{
+		const BinaryFBX::Element* connections = doc.findChild(doc.getRoot(), "Connections");
+		if (!connections) return;
+
+		FbxNode* root = scene.GetRootNode();
+		for (const BinaryFBX::Element* c = doc.getFirstChild(*connections); c; c = doc.getNextSibling(*c))
+		{
+			if (c->property_count < 3) continue;
+
+			const bool is_property = doc.getProperty(*c, 0)->toString() == "OP";
+			const u64 child_id = (u64)doc.getProperty(*c, 1)->toI64();
+			const u64 parent_id = (u64)doc.getProperty(*c, 2)->toI64();
+			BinaryFBX::DataView property;
+			if (is_property && c->property_count > 3) property = doc.getProperty(*c, 3)->toString();
+
+			auto child_iter = objects.find(child_id);
+			if (!child_iter.isValid()) continue;
+			Object& child = child_iter.value();
+
+			if (parent_id == 0)
+			{
+				if (child.type == ObjectType::MODEL) root->AddChild(static_cast<FbxNode*>(child.fbx));
+				continue;
+			}
+
+			auto parent_iter = objects.find(parent_id);
+			if (!parent_iter.isValid()) continue;
+			Object& parent = parent_iter.value();
+
+			switch (child.type)
+			{
+				case ObjectType::MODEL:
+					if (FbxNode* node = cast<FbxNode>(&parent, ObjectType::MODEL))
+					{
+						node->AddChild(static_cast<FbxNode*>(child.fbx));
+					}
+					else if (FbxCluster* cluster = cast<FbxCluster>(&parent, ObjectType::CLUSTER))
+					{
+						cluster->SetLink(static_cast<FbxNode*>(child.fbx));
+					}
+					break;
+				case ObjectType::GEOMETRY:
+					if (FbxNode* node = cast<FbxNode>(&parent, ObjectType::MODEL))
+					{
+						node->SetNodeAttribute(static_cast<FbxMesh*>(child.fbx));
+					}
+					break;
+				case ObjectType::MATERIAL:
+					if (FbxNode* node = cast<FbxNode>(&parent, ObjectType::MODEL))
+					{
+						node->AddMaterial(static_cast<FbxSurfaceMaterial*>(child.fbx));
+					}
+					break;
+				case ObjectType::TEXTURE:
+					if (FbxSurfaceMaterial* material = cast<FbxSurfaceMaterial>(&parent, ObjectType::MATERIAL))
+					{
+						char property_name[64];
+						property.toString(Span(property_name));
+						FbxProperty prop = material->FindProperty(property_name);
+						if (prop.IsValid()) prop.ConnectSrcObject(child.fbx);
+					}
+					break;
+				case ObjectType::SKIN:
+					if (FbxMesh* mesh = cast<FbxMesh>(&parent, ObjectType::GEOMETRY))
+					{
+						mesh->AddDeformer(static_cast<FbxSkin*>(child.fbx));
+					}
+					break;
+				case ObjectType::CLUSTER:
+					if (FbxSkin* skin = cast<FbxSkin>(&parent, ObjectType::SKIN))
+					{
+						skin->AddCluster(static_cast<FbxCluster*>(child.fbx));
+					}
+					break;
+				case ObjectType::ANIMATION_LAYER:
+					if (FbxAnimStack* stack = cast<FbxAnimStack>(&parent, ObjectType::ANIMATION_STACK))
+					{
+						stack->AddMember(static_cast<FbxAnimLayer*>(child.fbx));
+					}
+					break;
+				case ObjectType::ANIMATION_CURVE_NODE:
+					if (parent.type == ObjectType::ANIMATION_LAYER)
+					{
+						child.layer = static_cast<FbxAnimLayer*>(parent.fbx);
+					}
+					else if (parent.type == ObjectType::MODEL && is_property)
+					{
+						child.target = static_cast<FbxNode*>(parent.fbx);
+						child.target_property = property;
+					}
+					break;
+				case ObjectType::ANIMATION_CURVE:
+					if (parent.type == ObjectType::ANIMATION_CURVE_NODE && is_property)
+					{
+						child.curve_node = parent_id;
+						child.channel = property;
+					}
+					break;
+				// stacks belong to the scene, not to other objects
+				case ObjectType::ANIMATION_STACK:
+				case ObjectType::OTHER: break;
+			}
+		}
+	}
+
+
+	// only arrays of objects load() reads are inflated, e.g. unused geometry types and properties stay compressed
+	bool inflateArrays()
+	{
+		const BinaryFBX::Element* objects_element = doc.findChild(doc.getRoot(), "Objects");
+		if (!objects_element) return true;
+
+		Array<const BinaryFBX::Element*> elements(allocator);
+		for (const BinaryFBX::Element* el = doc.getFirstChild(*objects_element); el; el = doc.getNextSibling(*el))
+		{
+			if (el->property_count < 3) continue;
+
+			const BinaryFBX::DataView subclass = doc.getProperty(*el, 2)->toString();
+			if ((el->id == "Geometry" && subclass == "Mesh") || (el->id == "Deformer" && subclass == "Cluster")
+				|| el->id == "AnimationCurve")
+			{
+				elements.push(el);
+			}
+		}
+		return doc.inflateArrays(Span<const BinaryFBX::Element* const>(elements.begin(), elements.end()));
+	}
+
+
+	// property templates from Definitions are not applied, SDK defaults match the templates written by exporters
+	bool load()
+	{
+		loadGlobalSettings();
+		if (!loadObjects()) return false;
+		loadConnections();
+		for (u64 id : curves) loadCurve(objects.find(id).value());
+		loadTakes();
+		return true;
+	}
+
+
+	BinaryFBX::Document& doc;
+	FbxScene& scene;
+	IAllocator& allocator;
+	HashMap<u64, Object> objects;
+	Array<u64> curves;
+};
+
+
+// reads only element headers, array sizes are known without inflating the arrays
+static bool readPreview(const BinaryFBX::Document& doc, FBXImporter::ScenePreview& preview, IAllocator& allocator)
+{
+	const BinaryFBX::Element* objects = doc.findChild(doc.getRoot(), "Objects");
+	if (!objects) return false;
+
+	HashMap<u64, const BinaryFBX::Element*> geometries(allocator);
+	HashMap<u64, int> models(allocator);
+	HashMap<u64, bool> materials(allocator);
+	for (const BinaryFBX::Element* el = doc.getFirstChild(*objects); el; el = doc.getNextSibling(*el))
+	{
+		if (el->property_count < 3) continue;
+
+		const u64 id = (u64)doc.getProperty(*el, 0)->toI64();
+		const BinaryFBX::DataView subclass = doc.getProperty(*el, 2)->toString();
+		char name[64];
+		doc.getProperty(*el, 1)->toObjectName().toString(Span(name));
+
+		if (el->id == "Model")
+		{
+			if (subclass == "LimbNode" || subclass == "Limb" || subclass == "Root") ++preview.bones;
+			if (!(subclass == "Mesh")) continue;
+			models.insert(id, preview.meshes.size());
+			preview.meshes.emplace().name = name;
+		}
+		else if (el->id == "Geometry" && subclass == "Mesh")
+		{
+			geometries.insert(id, el);
+		}
+		else if (el->id == "Material")
+		{
+			materials.insert(id, true);
+			preview.materials.emplace(name);
+		}
+		else if (el->id == "AnimationStack")
+		{
+			FBXImporter::ScenePreview::AnimationStack& stack = preview.animations.emplace();
+			stack.name = name;
+			const BinaryFBX::Element* props = doc.findChild(*el, "Properties70");
+			for (const BinaryFBX::Element* p = props ? doc.getFirstChild(*props) : nullptr; p; p = doc.getNextSibling(*p))
+			{
+				if (p->property_count < 5) continue;
+
+				const BinaryFBX::DataView prop_name = doc.getProperty(*p, 0)->toString();
+				FbxTime time;
+				time.Set(doc.getProperty(*p, 4)->toI64());
+				if (prop_name == "LocalStart") stack.start = time.GetSecondDouble();
+				else if (prop_name == "LocalStop") stack.stop = time.GetSecondDouble();
+			}
+		}
+	}
+
+	const BinaryFBX::Element* connections = doc.findChild(doc.getRoot(), "Connections");
+	for (const BinaryFBX::Element* c = connections ? doc.getFirstChild(*connections) : nullptr; c; c = doc.getNextSibling(*c))
+	{
+		if (c->property_count < 3) continue;
+
+		const u64 child_id = (u64)doc.getProperty(*c, 1)->toI64();
+		const u64 parent_id = (u64)doc.getProperty(*c, 2)->toI64();
+		auto model_iter = models.find(parent_id);
+		if (!model_iter.isValid()) continue;
+
+		FBXImporter::ScenePreview::Mesh& mesh = preview.meshes[model_iter.value()];
+		if (materials.find(child_id).isValid())
+		{
+			++mesh.materials;
+			continue;
+		}
+
+		auto geom_iter = geometries.find(child_id);
+		if (!geom_iter.isValid()) continue;
+
+		const BinaryFBX::Element& geom = *geom_iter.value();
+		const BinaryFBX::Element* vertices = doc.findChild(geom, "Vertices");
+		const BinaryFBX::Element* indices = doc.findChild(geom, "PolygonVertexIndex");
+		if (vertices && vertices->property_count > 0) mesh.control_points = doc.getProperty(*vertices, 0)->count / 3;
+		if (indices && indices->property_count > 0) mesh.polygon_vertices = doc.getProperty(*indices, 0)->count;
+	}
+	return true;
+}
+
+
+static u32 packu32(u8 _x, u8 _y, u8 _z, u8 _w)
+{
+	union {
+		u32 ui32;
+		u8 arr[4];
+	} un;
+
+	un.arr[0] = _x;
+	un.arr[1] = _y;
+	un.arr[2] = _z;
+	un.arr[3] = _w;
+
+	return un.ui32;
+}
+
+
+static u32 packF4u(const Vec3& vec)
+{
+	const u8 xx = u8(vec.x * 127.0f + 128.0f);
+	const u8 yy = u8(vec.y * 127.0f + 128.0f);
+	const u8 zz = u8(vec.z * 127.0f + 128.0f);
+	const u8 ww = u8(0);
+	return packu32(xx, yy, zz, ww);
+}
+
+
+static Vec3 unpackF4u(u32 packed)
+{
+	u8 bytes[4];
+	memcpy(bytes, &packed, sizeof(bytes));
+	return {(bytes[0] - 128.0f) / 127.0f, (bytes[1] - 128.0f) / 127.0f, (bytes[2] - 128.0f) / 127.0f};
+}
+
+
+// round to nearest even, overflow to infinity
+static u16 floatToHalf(float value)
+{
+	u32 x;
+	memcpy(&x, &value, sizeof(x));
+	const u32 sign = (x >> 16) & 0x8000;
+	x &= 0x7fffFFFF;
+	if (x >= 0x7f800000) return u16(sign | 0x7c00 | (x > 0x7f800000 ? 0x200 : 0));
+	if (x >= 0x477ff000) return u16(sign | 0x7c00);
+	if (x < 0x38800000)
+	{
+		float abs_value;
+		memcpy(&abs_value, &x, sizeof(abs_value));
+		return u16(sign | u32(abs_value * 16777216.0f + 0.5f));
+	}
+	x += 0xc8000fff + ((x >> 13) & 1);
+	return u16(sign | (x >> 13));
+}
+
+
+static float halfToFloat(u16 value)
+{
+	const u32 sign = u32(value & 0x8000) << 16;
+	const u32 exponent = (value >> 10) & 0x1f;
+	const u32 mantissa = value & 0x3ff;
+	if (exponent == 0)
+	{
+		const float res = mantissa / 16777216.0f;
+		return sign ? -res : res;
+	}
+	const u32 bits = exponent == 0x1f ? sign | 0x7f800000 | (mantissa << 13) : sign | ((exponent + 112) << 23) | (mantissa << 13);
+	float res;
+	memcpy(&res, &bits, sizeof(res));
+	return res;
+}
+
+
+static i16 toSnorm16(float value)
+{
+	return (i16)floorf(clamp(value, -1.0f, 1.0f) * 32767.0f + 0.5f);
+}
+
+
+// unit vector folded onto the z+ hemisphere of an octahedron, see "A Survey of Efficient Representations for Independent Unit Vectors"
+static void encodeOctahedral(const Vec3& v, i16 (&out)[2])
+{
+	const float l1 = fabsf(v.x) + fabsf(v.y) + fabsf(v.z);
+	float x = l1 > 0 ? v.x / l1 : 0;
+	float y = l1 > 0 ? v.y / l1 : 0;
+	if (v.z < 0)
+	{
+		const float tmp = x;
+		x = (1 - fabsf(y)) * (x >= 0 ? 1 : -1);
+		y = (1 - fabsf(tmp)) * (y >= 0 ? 1 : -1);
+	}
+	out[0] = toSnorm16(x);
+	out[1] = toSnorm16(y);
+}
+
+
+static Vec3 decodeOctahedral(const i16 (&in)[2])
+{
+	const float x = maximum(in[0] / 32767.0f, -1.0f);
+	const float y = maximum(in[1] / 32767.0f, -1.0f);
+	Vec3 v(x, y, 1 - fabsf(x) - fabsf(y));
+	if (v.z < 0)
+	{
+		v.x = (1 - fabsf(y)) * (x >= 0 ? 1 : -1);
+		v.y = (1 - fabsf(x)) * (y >= 0 ? 1 : -1);
+	}
+	v.normalize();
+	return v;
+}
+
+
+static u16 toUnorm16(float value, float offset, float scale)
+{
+	if (scale <= 0) return 0;
+	return (u16)floorf(clamp((value - offset) / scale, 0.0f, 1.0f) * 65535.0f + 0.5f);
+}
+
+
+// value in [-range, range]
+template <typename T> static T toSnorm(float value, float range, float max)
+{
+	if (range <= 0) return 0;
+	return (T)floorf(clamp(value / range, -1.0f, 1.0f) * max + 0.5f);
+}
+
+
+static float getAngle(const Vec3& a, const Vec3& b)
+{
+	return acosf(clamp(dotProduct(a, b), -1.0f, 1.0f)) * 180 / PI;
+}
+
+
+// smallest three - the index of the largest component in the low 2 bits, then the other three components,
+// which are within +-1/sqrt(2), with component_bits each; the largest one is restored from the unit length
+static u64 packSmallestThree(const Quat& q, u32 component_bits)
+{
+	const float c[4] = {q.x, q.y, q.z, q.w};
+	u32 largest = 0;
+	for (u32 i = 1; i < 4; ++i)
+	{
+		if (fabsf(c[i]) > fabsf(c[largest])) largest = i;
+	}
+	// q and -q are the same rotation, the dropped component is always positive
+	const float sign = c[largest] < 0 ? -1.0f : 1.0f;
+	const float max_value = float((1 << component_bits) - 1);
+	u64 res = largest;
+	u32 shift = 2;
+	for (u32 i = 0; i < 4; ++i)
+	{
+		if (i == largest) continue;
+		const float normalized = clamp((c[i] * sign * SQRT2 + 1) * 0.5f, 0.0f, 1.0f);
+		res |= u64(floorf(normalized * max_value + 0.5f)) << shift;
+		shift += component_bits;
+	}
+	return res;
+}
+
+
+static Quat unpackSmallestThree(u64 packed, u32 component_bits)
+{
+	const u32 largest = u32(packed & 3);
+	const u64 mask = (u64(1) << component_bits) - 1;
+	const float max_value = float(mask);
+	float c[4];
+	float sum = 0;
+	u32 shift = 2;
+	for (u32 i = 0; i < 4; ++i)
+	{
+		if (i == largest) continue;
+		c[i] = (((packed >> shift) & mask) / max_value * 2 - 1) / SQRT2;
+		sum += c[i] * c[i];
+		shift += component_bits;
+	}
+	c[largest] = sqrtf(maximum(1 - sum, 0.0f));
+	return {c[0], c[1], c[2], c[3]};
+}
+
+
+// from the chord length, acos of the dot product is too imprecise for small angles
+static float getAngle(const Quat& a, const Quat& b)
+{
+	const float sign = a.x * b.x + a.y * b.y + a.z * b.z + a.w * b.w < 0 ? -1.0f : 1.0f;
+	const float dx = a.x - b.x * sign;
+	const float dy = a.y - b.y * sign;
+	const float dz = a.z - b.z * sign;
+	const float dw = a.w - b.w * sign;
+	const float chord = sqrtf(dx * dx + dy * dy + dz * dz + dw * dw);
+	return 4 * asinf(minimum(chord * 0.5f, 1.0f));
+}
+
+
+template <typename T>
+static T getLayerElement(const FbxLayerElementTemplate<T>* element, int control_point, int polygon_vertex)
+{
+	int idx = element->GetMappingMode() == FbxLayerElement::eByControlPoint ? control_point : polygon_vertex;
+	if (element->GetReferenceMode() != FbxLayerElement::eDirect) idx = element->GetIndexArray().GetAt(idx);
+	return element->GetDirectArray().GetAt(idx);
+}
+
+
+static bool hasPolygonMaterials(FbxMesh* mesh)
+{
+	if (mesh->GetElementMaterialCount() == 0) return false;
+	const FbxGeometryElementMaterial* element = mesh->GetElementMaterial(0);
+	return element->GetMappingMode() == FbxLayerElement::eByPolygon && element->GetIndexArray().GetCount() > 1;
+}
+
+
+// index into the node's materials, -1 if the mesh has none
+static int getPolygonMaterial(FbxMesh* mesh, int polygon)
+{
+	if (mesh->GetElementMaterialCount() == 0) return -1;
+	const auto& indices = mesh->GetElementMaterial(0)->GetIndexArray();
+	if (indices.GetCount() == 0) return -1;
+	if (!hasPolygonMaterials(mesh) || polygon >= indices.GetCount()) return indices.GetAt(0);
+	return indices.GetAt(polygon);
+}
+
+
+// replaces FbxGeometryConverter::Triangulate for imported meshes only
+// convex polygons are fanned, concave ones are ear clipped in the plane of the polygon
+struct PolygonTriangulator
+{
+	struct Point
+	{
+		double x, y;
+	};
+
+	explicit PolygonTriangulator(IAllocator& allocator)
+		: points(allocator)
+		, remaining(allocator)
+	{
+	}
+
+	// appends triangles as vertex positions within the polygon, the winding is kept
+	void triangulate(FbxMesh* mesh, int polygon, Array<int>& corners)
+	{
+		const int size = mesh->GetPolygonSize(polygon);
+		if (size < 3) return;
+		if (size == 3)
+		{
+			corners.push(0);
+			corners.push(1);
+			corners.push(2);
+			return;
+		}
+
+		// Newell's normal is robust for concave and slightly non planar polygons
+		FbxVector4 normal(0, 0, 0);
+		for (int i = 0; i < size; ++i)
+		{
+			const FbxVector4 a = mesh->GetControlPointAt(mesh->GetPolygonVertex(polygon, i));
+			const FbxVector4 b = mesh->GetControlPointAt(mesh->GetPolygonVertex(polygon, (i + 1) % size));
+			normal[0] += (a[1] - b[1]) * (a[2] + b[2]);
+			normal[1] += (a[2] - b[2]) * (a[0] + b[0]);
+			normal[2] += (a[0] - b[0]) * (a[1] + b[1]);
+		}
+		const double nx = fabs(normal[0]);
+		const double ny = fabs(normal[1]);
+		const double nz = fabs(normal[2]);
+		const int axis = nz >= nx && nz >= ny ? 2 : (ny >= nx ? 1 : 0);
+		const int u = (axis + 1) % 3;
+		const int v = (axis + 2) % 3;
+		sign = normal[axis] < 0 ? -1 : 1;
+
+		points.clear();
+		for (int i = 0; i < size; ++i)
+		{
+			const FbxVector4 p = mesh->GetControlPointAt(mesh->GetPolygonVertex(polygon, i));
+			points.push({p[u], p[v]});
+		}
+
+		bool convex = true;
+		for (int i = 0; i < size && convex; ++i)
+		{
+			convex = orient((i + size - 1) % size, i, (i + 1) % size) >= 0;
+		}
+
+		remaining.clear();
+		for (int i = 0; i < size; ++i) remaining.push(i);
+		while (!convex && remaining.size() > 3)
+		{
+			const int count = remaining.size();
+			int ear = -1;
+			for (int k = 0; k < count && ear < 0; ++k)
+			{
+				const int a = remaining[(k + count - 1) % count];
+				const int b = remaining[k];
+				const int c = remaining[(k + 1) % count];
+				if (orient(a, b, c) <= 0) continue;
+
+				bool is_ear = true;
+				for (int other : remaining)
+				{
+					if (other == a || other == b || other == c) continue;
+					if (orient(a, b, other) >= 0 && orient(b, c, other) >= 0 && orient(c, a, other) >= 0)
+					{
+						is_ear = false;
+						break;
+					}
+				}
+				if (is_ear) ear = k;
+			}
+			// self intersecting or degenerate, the rest is fanned
+			if (ear < 0) break;
+
+			corners.push(remaining[(ear + count - 1) % count]);
+			corners.push(remaining[ear]);
+			corners.push(remaining[(ear + 1) % count]);
+			remaining.erase(ear);
+		}
+
+		for (int i = 1; i + 1 < remaining.size(); ++i)
+		{
+			corners.push(remaining[0]);
+			corners.push(remaining[i]);
+			corners.push(remaining[i + 1]);
+		}
+	}
+
+	// positive if a, b, c turn the same way as the polygon
+	double orient(int a, int b, int c) const
+	{
+		const Point& pa = points[a];
+		const Point& pb = points[b];
+		const Point& pc = points[c];
+		return ((pb.x - pa.x) * (pc.y - pa.y) - (pb.y - pa.y) * (pc.x - pa.x)) * sign;
+	}
+
+	Array<Point> points;
+	Array<int> remaining;
+	double sign = 1;
+};
+
+
+static int detectMeshLOD(const FBXImporter::ImportMesh& mesh)
+{
+	const char* node_name = mesh.fbx->GetNode()->GetName();
+	const char* lod_str = stristr(node_name, "_LOD");
+	if (!lod_str)
+	{ 
+		const char* mesh_name = FBXImporter::getImportMeshName(mesh);
+		if (!mesh_name) return 0;
+
+		const char* lod_str = stristr(mesh_name, "_LOD");
+		if (!lod_str) return 0;
+	}
+
+	lod_str += stringLength("_LOD");
+
+	int lod;
+	fromCString(Span(lod_str, stringLength(lod_str)), Ref(lod));
+
+	return lod;
+}
+
+
+static Vec3 toLumixVec3(const FbxVector4& v) { return{ (float)v.mData[0], (float)v.mData[1], (float)v.mData[2] }; }
+static Quat toLumix(const FbxQuaternion& q)
+{
+	return {(float)q.mData[0], (float)q.mData[1], (float)q.mData[2], (float)q.mData[3]};
+}
+
+static Matrix toLumix(const FbxAMatrix& mtx)
+{
+	Matrix res;
+
+	res.m11 = (float)mtx.mData[0].mData[0];
+	res.m12 = (float)mtx.mData[0].mData[1];
+	res.m13 = (float)mtx.mData[0].mData[2];
+	res.m14 = (float)mtx.mData[0].mData[3];
+
+	res.m21 = (float)mtx.mData[1].mData[0];
+	res.m22 = (float)mtx.mData[1].mData[1];
+	res.m23 = (float)mtx.mData[1].mData[2];
+	res.m24 = (float)mtx.mData[1].mData[3];
+
+	res.m31 = (float)mtx.mData[2].mData[0];
+	res.m32 = (float)mtx.mData[2].mData[1];
+	res.m33 = (float)mtx.mData[2].mData[2];
+	res.m34 = (float)mtx.mData[2].mData[3];
+
+	res.m41 = (float)mtx.mData[3].mData[0];
+	res.m42 = (float)mtx.mData[3].mData[1];
+	res.m43 = (float)mtx.mData[3].mData[2];
+	res.m44 = (float)mtx.mData[3].mData[3];
+
+	return res;
+}
+
+
+// local transforms of animated bones, every bone is evaluated once per frame
+// structure of arrays, samples of one bone are contiguous
+struct PoseBuffer
+{
+	explicit PoseBuffer(IAllocator& allocator)
+		: bones(allocator)
+		, translations(allocator)
+		, rotations(allocator)
+		, scales(allocator)
+	{
+	}
+
+	void sample(FbxAnimEvaluator* eval, int frames, float sample_period)
+	{
+		frame_count = frames;
+		const int count = bones.size() * frame_count;
+		translations.resize(count);
+		rotations.resize(count);
+		scales.resize(count);
+		for (int frame = 0; frame < frame_count; ++frame)
+		{
+			const FbxTime time = FbxTimeSeconds(frame * sample_period);
+			for (int i = 0, c = bones.size(); i < c; ++i)
+			{
+				const FbxAMatrix& mtx = eval->GetNodeLocalTransform(bones[i], time);
+				const int idx = i * frame_count + frame;
+				translations[idx] = toLumixVec3(mtx.GetT());
+				Quat rot = toLumix(mtx.GetQ());
+				// keep neighbouring samples in the same hemisphere, so interpolation between them takes the short way
+				if (frame > 0)
+				{
+					const Quat& prev = rotations[idx - 1];
+					if (prev.x * rot.x + prev.y * rot.y + prev.z * rot.z + prev.w * rot.w < 0) rot = {-rot.x, -rot.y, -rot.z, -rot.w};
+				}
+				rotations[idx] = rot;
+				scales[idx] = toLumixVec3(mtx.GetS());
+			}
+		}
+	}
+
+	Span<const Vec3> getTranslations(int bone) const { return Span<const Vec3>(&translations[bone * frame_count], frame_count); }
+	Span<const Quat> getRotations(int bone) const { return Span<const Quat>(&rotations[bone * frame_count], frame_count); }
+	Span<const Vec3> getScales(int bone) const { return Span<const Vec3>(&scales[bone * frame_count], frame_count); }
+
+	void removeBone(int bone)
+	{
+		for (int i = bone * frame_count, c = translations.size() - frame_count; i < c; ++i)
+		{
+			translations[i] = translations[i + frame_count];
+			rotations[i] = rotations[i + frame_count];
+			scales[i] = scales[i + frame_count];
+		}
+		translations.resize(translations.size() - frame_count);
+		rotations.resize(rotations.size() - frame_count);
+		scales.resize(scales.size() - frame_count);
+		bones.erase(bone);
+	}
+
+	Array<FbxNode*> bones;
+	int frame_count = 0;
+	Array<Vec3> translations;
+	Array<Quat> rotations;
+	Array<Vec3> scales;
+};
+
+
+// end of the segment starting at key, doubles the candidate length until isValid fails, then bisects
+// between the last valid and the first invalid end; isValid(key, end) is O(end - key), so a track costs
+// O(n log n) instead of O(n^2) for long flat segments; every returned end has been validated
+template <typename F>
+static int findSegmentEnd(int key, int frames, F& isValid)
+{
+	int good = key + 1;
+	int bad = frames + 1;
+	for (int step = 1; good < frames; step *= 2)
+	{
+		const int probe = minimum(good + step, frames);
+		if (!isValid(key, probe))
+		{
+			bad = probe;
+			break;
+		}
+		good = probe;
+	}
+	while (bad - good > 1)
+	{
+		const int mid = (good + bad) / 2;
+		if (isValid(key, mid)) good = mid;
+		else bad = mid;
+	}
+	return good;
+}
+
+
+// greedy piecewise linear fit, each segment is extended (see findSegmentEnd) while interpolating between
+// its end keys stays within max_error of every sample it spans, which is how the runtime reconstructs the track
+// samples has one more element than frames, the last one is at frames * sample_period
+// arg parent_scale - animated scale is not supported, but we can get rid of static scale if we ignore 
+// it in writeSkeleton() and use parent_scale in this function
+static void compressPositions(Array<FBXImporter::TranslationKey>& out,
+	Span<const Vec3> samples,
+	float sample_period,
+	float max_error,
+	float parent_scale)
+{
+	out.clear();
+	const int frames = (int)samples.length() - 1;
+	if (frames <= 0) return;
+
+	const float max_error_squared = max_error * max_error;
+	auto isValid = [&](int from, int to) {
+		const Vec3 a = samples[from] * parent_scale;
+		const Vec3 b = samples[to] * parent_scale;
+		for (int i = from + 1; i < to; ++i)
+		{
+			const Vec3 estimate = a + (b - a) * ((i - from) / float(to - from));
+			if ((estimate - samples[i] * parent_scale).squaredLength() > max_error_squared) return false;
+		}
+		return true;
+	};
+
+	out.push({samples[0] * parent_scale, 0, 0});
+	int key = 0;
+	while (key < frames)
+	{
+		const int next = findSegmentEnd(key, frames, isValid);
+		out.push({samples[next] * parent_scale, next * sample_period, (u16)next});
+		key = next;
+	}
+}
+
+
+// local space deltas, the reference has either the same number of frames or a single one
+static void makeAdditive(PoseBuffer& pose, const PoseBuffer& reference)
+{
+	for (int bone = 0; bone < pose.bones.size(); ++bone)
+	{
+		for (int frame = 0; frame < pose.frame_count; ++frame)
+		{
+			const int idx = bone * pose.frame_count + frame;
+			const int reference_idx = bone * reference.frame_count + (reference.frame_count == 1 ? 0 : frame);
+			pose.translations[idx] = pose.translations[idx] - reference.translations[reference_idx];
+			Quat rot = reference.rotations[reference_idx].conjugated() * pose.rotations[idx];
+			// the first delta is next to identity, the rest follows it like in sample
+			const Quat prev = frame > 0 ? pose.rotations[idx - 1] : Quat::IDENTITY;
+			if (prev.x * rot.x + prev.y * rot.y + prev.z * rot.z + prev.w * rot.w < 0) rot = {-rot.x, -rot.y, -rot.z, -rot.w};
+			pose.rotations[idx] = rot;
+		}
+	}
+}
+
+
+// moves the horizontal translation and the yaw of a bone from its samples to translations and yaws,
+// both relative to the first frame, so the bone stays where and how it was turned in the first frame
+// yaws are in x, so they can be reduced like translations
+static void extractRootMotion(PoseBuffer& pose, int bone, const Vec3& up, Array<Vec3>& translations, Array<Vec3>& yaws)
+{
+	translations.clear();
+	yaws.clear();
+	Vec3* bone_translations = &pose.translations[bone * pose.frame_count];
+	Quat* bone_rotations = &pose.rotations[bone * pose.frame_count];
+	const Vec3 start = bone_translations[0] - up * dotProduct(bone_translations[0], up);
+	float start_yaw = 0;
+	float prev_yaw = 0;
+	for (int frame = 0; frame < pose.frame_count; ++frame)
+	{
+		Vec3& t = bone_translations[frame];
+		const Vec3 horizontal = t - up * dotProduct(t, up);
+		translations.push(horizontal - start);
+		t = t - horizontal + start;
+
+		// twist about up, unwrapped so the track does not jump at +-180 degrees
+		Quat& rot = bone_rotations[frame];
+		float yaw = 2 * atan2f(rot.x * up.x + rot.y * up.y + rot.z * up.z, rot.w);
+		if (frame == 0) start_yaw = prev_yaw = yaw;
+		while (yaw - prev_yaw > PI) yaw -= 2 * PI;
+		while (yaw - prev_yaw < -PI) yaw += 2 * PI;
+		prev_yaw = yaw;
+		yaws.push({yaw - start_yaw, 0, 0});
+		rot = Quat(up, start_yaw - yaw) * rot;
+	}
+}
+
+
+// same as compressPositions, max_angle is in radians
+static void compressRotations(Array<FBXImporter::RotationKey>& out,
+	Span<const Quat> samples,
+	float sample_period,
+	float max_angle)
+{
+	out.clear();
+	const int frames = (int)samples.length() - 1;
+	if (frames <= 0) return;
+
+	// angle between unit quaternions is 2 * acos(|dot|)
+	const float min_dot = cosf(minimum(max_angle, PI) * 0.5f);
+	auto isValid = [&](int from, int to) {
+		for (int i = from + 1; i < to; ++i)
+		{
+			const Quat estimate = nlerp(samples[from], samples[to], (i - from) / float(to - from));
+			const Quat& q = samples[i];
+			const float dot = estimate.x * q.x + estimate.y * q.y + estimate.z * q.z + estimate.w * q.w;
+			if (fabsf(dot) < min_dot) return false;
+		}
+		return true;
+	};
+
+	out.push({samples[0], 0, 0});
+	int key = 0;
+	while (key < frames)
+	{
+		const int next = findSegmentEnd(key, frames, isValid);
+		out.push({samples[next], next * sample_period, (u16)next});
+		key = next;
+	}
+}
+
+
+FBXImporter::StageScope::StageScope(FBXImporter& importer, const char* name)
+	: importer(importer)
+	, name(name)
+	, start(importer.stage_timer.getTimeSinceStart())
+	, depth(stage_depth++)
+{
+}
+
+
+FBXImporter::StageScope::~StageScope()
+{
+	--stage_depth;
+	importer.pushStage(name, start, importer.stage_timer.getTimeSinceStart() - start, depth);
+}
+
+
+void FBXImporter::pushStage(const char* name, float start, float time, u32 depth)
+{
+	StageStats stats;
+	stats.name = name;
+	stats.start = start;
+	stats.time = time;
+	stats.peak_memory = getPeakMemory();
+	stats.thread = stage_thread;
+	stats.depth = depth;
+
+	// nested stages finish first, keep the list ordered by start
+	MutexGuard guard(stage_mutex);
+	int idx = stage_stats.size();
+	while (idx > 0 && stage_stats[idx - 1].start > start) --idx;
+	stage_stats.insert(idx, stats);
+}
+
+
+void FBXImporter::clearStats()
+{
+	MutexGuard guard(stage_mutex);
+	stage_stats.clear();
+	output_stats.clear();
+}
+
+
+void FBXImporter::gatherSourceStats(const char* filename, int first_mesh)
+{
+	FileStats& stats = source_stats.emplace();
+	stats.path = filename;
+	for (int i = first_mesh; i < meshes.size(); ++i)
+	{
+		FbxMesh* mesh = meshes[i].fbx;
+		// meshes with more materials are split into consecutive import meshes
+		if (i > first_mesh && meshes[i - 1].fbx == mesh) continue;
+
+		stats.polygons += mesh->GetPolygonCount();
+		stats.control_points += mesh->GetControlPointsCount();
+		if (mesh->GetDeformerCount(FbxDeformer::EDeformerType::eSkin) > 0)
+		{
+			auto* skin = static_cast<FbxSkin*>(mesh->GetDeformer(0, FbxDeformer::EDeformerType::eSkin));
+			stats.clusters += skin->GetClusterCount();
+		}
+	}
+
+	OS::InputFile file;
+	if (file.open(filename))
+	{
+		stats.bytes = file.size();
+		file.close();
+	}
+}
+
+
+void FBXImporter::updateMemoryStats()
+{
+	for (int i = 0; i < source_stats.size() && i < scene_memory.size(); ++i)
+	{
+		const FBXMemory::Stats stats = FBXMemory::getSlotStats(scene_memory[i].slot);
+		source_stats[i].sdk_memory = stats.current;
+		source_stats[i].sdk_peak_memory = stats.peak;
+	}
+}
+
+
+void FBXImporter::gatherOutputStats()
+{
+	output_stats.clear();
+	for (const auto& filename : output_files)
+	{
+		FileStats& stats = output_stats.emplace();
+		stats.path = filename;
+		OS::InputFile file;
+		if (file.open(StaticString<MAX_PATH_LENGTH>(output_dir, filename)))
+		{
+			stats.bytes = file.size();
+			file.close();
+		}
+	}
+}
+
+
+static void writeJSONString(OS::OutputFile& file, const char* str)
+{
+	file.write("\"", 1);
+	for (; *str; ++str)
+	{
+		if (*str == '"' || *str == '\\') file.write("\\", 1);
+		file.write(str, 1);
+	}
+	file.write("\"", 1);
+}
+
+
+bool FBXImporter::writeTrace(const char* path)
+{
+	OS::OutputFile file;
+	if (!file.open(path))
+	{
+		logError("FBX") << "Failed to create " << path;
+		return false;
+	}
+
+	auto writeString = [&file](const char* str) { file.write(str, stringLength(str)); };
+	writeString("{\"traceEvents\":[");
+	const char* separator = "\n";
+	float end = 0;
+	for (const StageStats& stats : stage_stats)
+	{
+		writeString(separator);
+		separator = ",\n";
+		writeString("{\"name\":");
+		writeJSONString(file, stats.name);
+		writeString(StaticString<256>(",\"ph\":\"X\",\"pid\":0,\"tid\":",
+			stats.thread,
+			",\"ts\":",
+			u64(stats.start * 1e6),
+			",\"dur\":",
+			u64(stats.time * 1e6),
+			",\"args\":{\"peak_memory\":",
+			stats.peak_memory,
+			"}}"));
+		end = maximum(end, stats.start + stats.time);
+	}
+
+	auto writeFiles = [&](const Array<FileStats>& files, const char* category) {
+		for (const FileStats& stats : files)
+		{
+			writeString(separator);
+			separator = ",\n";
+			writeString("{\"name\":");
+			writeJSONString(file, stats.path);
+			writeString(StaticString<512>(",\"cat\":\"",
+				category,
+				"\",\"ph\":\"i\",\"s\":\"g\",\"pid\":0,\"tid\":0,\"ts\":",
+				u64(end * 1e6),
+				",\"args\":{\"polygons\":",
+				stats.polygons,
+				",\"control_points\":",
+				stats.control_points,
+				",\"clusters\":",
+				stats.clusters,
+				",\"animation_frames\":",
+				stats.animation_frames,
+				",\"bytes\":",
+				stats.bytes,
+				",\"sdk_memory\":",
+				stats.sdk_memory,
+				",\"sdk_peak_memory\":",
+				stats.sdk_peak_memory,
+				"}}"));
+		}
+	};
+	writeFiles(source_stats, "source");
+	writeFiles(output_stats, "output");
+
+	writeString("\n]}\n");
+	file.close();
+	return true;
+}
+
+
+u64 FBXImporter::getPeakMemory()
+{
+#ifdef _WIN32
+	PROCESS_MEMORY_COUNTERS counters;
+	if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) return 0;
+	return (u64)counters.PeakWorkingSetSize;
+#else
+	rusage usage;
+	if (getrusage(RUSAGE_SELF, &usage) != 0) return 0;
+	return (u64)usage.ru_maxrss * 1024;
+#endif
+}
+
+
+FBXImporter::FBXImporter(IAllocator& allocator)
+	: allocator(allocator)
+	, worker_managers(allocator)
+	, materials(allocator)
+	, meshes(allocator)
+	, animations(allocator)
+	, bones(allocator)
+	, bone_indices(allocator)
+	, bone_clusters(allocator)
+	, skeletons(allocator)
+	, scenes(allocator)
+	, scene_memory(allocator)
+	, scene_bones(allocator)
+	, source_paths(allocator)
+	, previews(allocator)
+	, stage_stats(allocator)
+	, source_stats(allocator)
+	, output_stats(allocator)
+	, output_files(allocator)
+	, output_sizes(allocator)
+{
+	FBXMemory::install(allocator);
+	fbx_manager = createManager();
+	out_buffer = (u8*)allocator.allocate_aligned(OUTPUT_BUFFER_SIZE, 4096);
+}
+
+
+FBXImporter::~FBXImporter()
+{
+	clearSources();
+	for (FbxManager* manager : worker_managers) manager->Destroy();
+	fbx_manager->Destroy();
+	allocator.deallocate_aligned(out_buffer);
+}
+
+
+FbxManager* FBXImporter::createManager()
+{
+	// blocks allocated by the SDK's default handlers have no BlockHeader and cannot be freed by ours
+	ASSERT(FBXMemory::isInstalled());
+	FbxManager* manager = FbxManager::Create();
+	FbxIOSettings* ios = FbxIOSettings::Create(manager, IOSROOT);
+	manager->SetIOSettings(ios);
+	return manager;
+}
+
+
+const char* FBXImporter::getImportMeshName(const ImportMesh& mesh)
+{
+	const char* name = mesh.fbx->GetName();
+	FbxSurfaceMaterial* material = mesh.fbx_mat;
+	if (name[0] == '\0') name = mesh.fbx->GetNode()->GetName();
+	if (name[0] == '\0' && material) name = material->GetName();
+	return name;
+}
+
+
+int FBXImporter::getBoneIndex(FbxNode* node) const
+{
+	auto iter = bone_indices.find(node);
+	return iter.isValid() ? iter.value() : -1;
+}
+
+
+FbxAMatrix FBXImporter::getBindPoseMatrix(FbxNode* node) const
+{
+	// bones no mesh is skinned to, e.g. parents of rigid meshes, are bound where they are in the scene
+	auto iter = bone_clusters.find(node);
+	if (!iter.isValid()) return node->EvaluateGlobalTransform();
+
+	FbxAMatrix transform_link_matrix;
+	iter.value()->GetTransformLinkMatrix(transform_link_matrix);
+	return transform_link_matrix;
+}
+
+
+void FBXImporter::insertHierarchy(FbxNode* node, Array<FbxNode*>& scene_bones)
+{
+	if (!node) return;
+	if (bone_indices.find(node).isValid()) return;
+	insertHierarchy(node->GetParent(), scene_bones);
+	bone_indices.insert(node, bones.size() + scene_bones.size());
+	scene_bones.push(node);
+}
+
+
+void FBXImporter::gatherMaterials(FbxNode* node)
+{
+	for (int i = 0; i < node->GetMaterialCount(); ++i)
+	{
+		materials.emplace().fbx = node->GetMaterial(i);
+	}
+
+	for (int i = 0; i < node->GetChildCount(); ++i)
+	{
+		gatherMaterials(node->GetChild(i));
+	}
+}
+
+
+void FBXImporter::gatherBones(FbxNode* node, Array<FbxNode*>& scene_bones)
+{
+	const FbxNodeAttribute* node_attr = node->GetNodeAttribute();
+	bool is_bone = node_attr && node_attr->GetAttributeType() == FbxNodeAttribute::EType::eSkeleton;
+
+	if (is_bone) insertHierarchy(node, scene_bones);
+
+	for (int i = 0; i < node->GetChildCount(); ++i)
+	{
+		gatherBones(node->GetChild(i), scene_bones);
+	}
+}
+
+
+static bool equalBindPoses(const FbxAMatrix& a, const FbxAMatrix& b)
+{
+	for (int row = 0; row < 4; ++row)
+	{
+		for (int col = 0; col < 4; ++col)
+		{
+			const double x = a.Get(row, col);
+			const double y = b.Get(row, col);
+			if (fabs(x - y) > BIND_POSE_TOLERANCE * maximum(1.0, maximum(fabs(x), fabs(y)))) return false;
+		}
+	}
+	return true;
+}
+
+
+// animation libraries repeat the rig in every file, only the first copy becomes bones
+// skeletons match by bone names and hierarchy, local transforms are exporter noise, so only
+// bind poses of bones skinned in both sources are compared; expects clusters of the scene gathered
+void FBXImporter::shareSkeleton(Array<FbxNode*>& scene_bones, const char* filename)
+{
+	if (scene_bones.empty()) return;
+
+	HashMap<FbxNode*, int> scene_indices(allocator);
+	for (int i = 0; i < scene_bones.size(); ++i) scene_indices.insert(scene_bones[i], i);
+
+	CacheHasher hasher;
+	hasher.update(scene_bones.size());
+	for (FbxNode* node : scene_bones)
+	{
+		hasher.updateString(node->GetName());
+		auto parent = scene_indices.find(node->GetParent());
+		hasher.update(parent.isValid() ? parent.value() : -1);
+	}
+
+	for (const Skeleton& skeleton : skeletons)
+	{
+		if (skeleton.hash != hasher.hash || skeleton.bone_count != scene_bones.size()) continue;
+
+		bool same_bind_pose = true;
+		for (int i = 0; i < scene_bones.size() && same_bind_pose; ++i)
+		{
+			auto cluster = bone_clusters.find(scene_bones[i]);
+			auto shared_cluster = bone_clusters.find(bones[skeleton.first_bone + i]);
+			if (!cluster.isValid() || !shared_cluster.isValid()) continue;
+
+			FbxAMatrix bind_pose, shared_bind_pose;
+			cluster.value()->GetTransformLinkMatrix(bind_pose);
+			shared_cluster.value()->GetTransformLinkMatrix(shared_bind_pose);
+			same_bind_pose = equalBindPoses(bind_pose, shared_bind_pose);
+		}
+		if (!same_bind_pose)
+		{
+			logInfo("FBX") << filename << " has the bones of " << source_paths[skeleton.scene] << " in a different bind pose";
+			continue;
+		}
+
+		for (int i = 0; i < scene_bones.size(); ++i)
+		{
+			FbxNode* shared_bone = bones[skeleton.first_bone + i];
+			bone_indices[scene_bones[i]] = skeleton.first_bone + i;
+			// bind poses of the shared bones come from whichever source skins them first
+			auto cluster = bone_clusters.find(scene_bones[i]);
+			if (cluster.isValid() && !bone_clusters.find(shared_bone).isValid()) bone_clusters.insert(shared_bone, cluster.value());
+		}
+		logInfo("FBX") << filename << " shares the skeleton of " << source_paths[skeleton.scene];
+		return;
+	}
+
+	Skeleton& skeleton = skeletons.emplace();
+	skeleton.hash = hasher.hash;
+	skeleton.first_bone = bones.size();
+	skeleton.bone_count = scene_bones.size();
+	skeleton.scene = scenes.size();
+	for (FbxNode* node : scene_bones) bones.push(node);
+}
+
+
+void FBXImporter::gatherBoneClusters(int first_mesh)
+{
+	for (int i = first_mesh; i < meshes.size(); ++i)
+	{
+		FbxMesh* mesh = meshes[i].fbx;
+		if (mesh->GetDeformerCount(FbxDeformer::EDeformerType::eSkin) <= 0) continue;
+		FbxDeformer* deformer = mesh->GetDeformer(0, FbxDeformer::EDeformerType::eSkin);
+		auto* skin = static_cast<FbxSkin*>(deformer);
+		for (int j = 0, c = skin->GetClusterCount(); j < c; ++j)
+		{
+			FbxCluster* cluster = skin->GetCluster(j);
+			FbxNode* link = cluster->GetLink();
+			if (link && !bone_clusters.find(link).isValid()) bone_clusters.insert(link, cluster);
+		}
+	}
+}
+
+
+void FBXImporter::gatherAnimations(FbxScene* scene)
+{
+	int anim_count = scene->GetSrcObjectCount<FbxAnimStack>();
+	for (int i = 0; i < anim_count; ++i)
+	{
+		ImportAnimation& anim = animations.emplace();
+		anim.fbx = scene->GetSrcObject<FbxAnimStack>(i);
+		anim.import = true;
+		anim.root_motion_bone = root_motion_bone;
+		anim.additive_reference = additive_reference;
+		
+		const FbxTakeInfo* take_info = scene->GetTakeInfo(anim.fbx->GetName());
+		if (take_info)
+		{
+			if (!take_info->mName.IsEmpty()) anim.output_filename = take_info->mName.Buffer();
+			if (anim.output_filename.empty() && !take_info->mImportName.IsEmpty()) anim.output_filename = take_info->mImportName.Buffer();
+			if (anim.output_filename.empty()) anim.output_filename << "anim";
+		}
+		else
+		{
+			anim.output_filename = "anim";
+		}
+		anim.output_filename = anim.fbx->GetName();
+	}
+}
+
+
+void FBXImporter::gatherMeshes(FbxScene* scene)
+{
+	// one import mesh per material, like FbxGeometryConverter::SplitMeshesPerMaterial, but nothing is copied
+	Array<int> used_materials(allocator);
+	int c = scene->GetSrcObjectCount<FbxMesh>();
+	for (int i = 0; i < c; ++i)
+	{
+		FbxMesh* fbx = scene->GetSrcObject<FbxMesh>(i);
+		// blend shape deformers can be next to the skin, but only one skin is supported
+		if (fbx->GetDeformerCount(FbxDeformer::EDeformerType::eSkin) > 1)
+		{
+			logWarning("FBX") << "Mesh " << fbx->GetNode()->GetName() << " has more than one skin, only the first one is used";
+		}
+		used_materials.clear();
+		for (int j = 0, polygon_count = fbx->GetPolygonCount(); j < polygon_count; ++j)
+		{
+			const int material = getPolygonMaterial(fbx, j);
+			if (used_materials.indexOf(material) < 0) used_materials.push(material);
+			// without per polygon materials, the first polygon decides
+			if (j == 0 && !hasPolygonMaterials(fbx)) break;
+		}
+		if (used_materials.empty()) used_materials.push(getPolygonMaterial(fbx, 0));
+
+		for (int material : used_materials)
+		{
+			ImportMesh& mesh = meshes.emplace(allocator);
+			mesh.fbx = fbx;
+			mesh.lod = detectMeshLOD(mesh);
+			if (used_materials.size() > 1) mesh.material_index = material;
+			if (material >= 0) mesh.fbx_mat = fbx->GetNode()->GetMaterial(material);
+		}
+	}
+}
+
+
+FbxScene* FBXImporter::loadSDK(FbxManager& manager, const char* filename)
+{
+	FbxImporter* importer = FbxImporter::Create(&manager, "");
+
+	bool initialized;
+	{
+		StageScope stage(*this, "FbxImporter::Initialize");
+		initialized = importer->Initialize(filename, -1, manager.GetIOSettings());
+	}
+	if (!initialized)
+	{
+		logError("FBX") << "Failed to initialize fbx importer: " << importer->GetStatus().GetErrorString();
+		importer->Destroy();
+		return nullptr;
+	}
+
+	FbxScene* scene = FbxScene::Create(&manager, "myScene");
+	bool imported;
+	{
+		StageScope stage(*this, "FbxImporter::Import");
+		imported = importer->Import(scene);
+	}
+	if (!imported)
+	{
+		logError("FBX") << "Failed to import \"" << filename << "\": " << importer->GetStatus().GetErrorString();
+		importer->Destroy();
+		scene->Destroy();
+		return nullptr;
+	}
+
+	importer->Destroy();
+	return scene;
+}
+
+
+FbxScene* FBXImporter::loadNative(FbxManager& manager, const char* filename)
+{
+	BinaryFBX::Document doc(allocator);
+	if (!doc.open(filename))
+	{
+		logError("FBX") << "Failed to load \"" << filename << "\": " << doc.getError();
+		return nullptr;
+	}
+
+	FbxScene* scene = FbxScene::Create(&manager, "myScene");
+	NativeSceneLoader loader(doc, *scene, allocator);
+	if (!loader.inflateArrays())
+	{
+		logError("FBX") << "Failed to load \"" << filename << "\": " << doc.getError();
+		scene->Destroy();
+		return nullptr;
+	}
+	if (!loader.load())
+	{
+		logError("FBX") << "Failed to load \"" << filename << "\": invalid objects";
+		scene->Destroy();
+		return nullptr;
+	}
+	return scene;
+}
+
+
+// only binary files can be loaded natively, ASCII files go through the SDK
+bool FBXImporter::isBinaryFBX(const char* filename) const
+{
+	static const char MAGIC[] = "Kaydara FBX Binary  ";
+	char header[sizeof(MAGIC) - 1];
+	OS::InputFile file;
+	if (!file.open(filename)) return false;
+	const bool read = file.read(header, sizeof(header));
+	file.close();
+	return read && memcmp(header, MAGIC, sizeof(header)) == 0;
+}
+
+
+bool FBXImporter::previewSource(const char* filename)
+{
+	if (!isBinaryFBX(filename)) return false;
+
+	PathInfo info(filename);
+	StageScope stage(*this, StaticString<64>("preview ", info.m_basename));
+	BinaryFBX::Document doc(allocator);
+	if (!doc.open(filename))
+	{
+		logError("FBX") << "Failed to preview \"" << filename << "\": " << doc.getError();
+		return false;
+	}
+
+	const bool first = scenes.empty() && previews.empty();
+	ScenePreview& preview = previews.emplace(allocator);
+	preview.path = filename;
+	if (!readPreview(doc, preview, allocator))
+	{
+		logError("FBX") << "Failed to preview \"" << filename << "\": no objects";
+		previews.pop();
+		return false;
+	}
+
+	if (first) Path::getBasename(Span(output_mesh_filename.data, lengthOf(output_mesh_filename.data)), filename);
+	return true;
+}
+
+
+bool FBXImporter::loadPreviewed()
+{
+	if (previews.empty()) return true;
+
+	Array<const char*> filenames(allocator);
+	for (const ScenePreview& preview : previews) filenames.push(preview.path.data);
+
+	const StaticString<MAX_PATH_LENGTH> mesh_filename = output_mesh_filename;
+	const bool preview = preview_sources;
+	preview_sources = false;
+	const bool success = addSources(Span<const char* const>(filenames.begin(), filenames.end()));
+	preview_sources = preview;
+	output_mesh_filename = mesh_filename;
+	previews.clear();
+	return success;
+}
+
+
+void FBXImporter::benchmarkReaders()
+{
+	for (const auto& path : source_paths)
+	{
+		OS::Timer timer;
+		FbxScene* scene = loadSDK(*fbx_manager, path);
+		const float sdk_time = timer.tick();
+		if (scene) scene->Destroy();
+
+		if (!isBinaryFBX(path))
+		{
+			logInfo("FBX") << path << ": SDK " << sdk_time * 1000 << " ms, not a binary FBX";
+			continue;
+		}
+
+		timer.tick();
+		scene = loadNative(*fbx_manager, path);
+		const float native_time = timer.tick();
+		if (scene) scene->Destroy();
+
+		logInfo("FBX") << path << ": SDK " << sdk_time * 1000 << " ms, native " << native_time * 1000 << " ms";
+	}
+}
+
+
+FbxScene* FBXImporter::loadScene(FbxManager& manager, const char* filename)
+{
+	return use_native_reader && isBinaryFBX(filename) ? loadNative(manager, filename) : loadSDK(manager, filename);
+}
+
+
+void FBXImporter::addScene(FbxScene* scene, const char* filename, const SceneMemory& memory)
+{
+	if (scenes.empty())
+	{
+		Path::getBasename(Span(output_mesh_filename.data, lengthOf(output_mesh_filename.data)), filename);
+	}
+
+	{
+		StageScope stage(*this, "gather");
+		FbxNode* root = scene->GetRootNode();
+		{
+			StageScope stage(*this, "gather materials");
+			gatherMaterials(root);
+			materials.removeDuplicates([](const ImportMaterial& a, const ImportMaterial& b) { return a.fbx == b.fbx; });
+		}
+		const int first_mesh = meshes.size();
+		{
+			StageScope stage(*this, "gather meshes");
+			gatherMeshes(scene);
+		}
+		Array<FbxNode*>& bone_nodes = scene_bones.emplace(allocator);
+		{
+			StageScope stage(*this, "gather bones");
+			gatherBones(root, bone_nodes);
+			gatherBoneClusters(first_mesh);
+			shareSkeleton(bone_nodes, filename);
+		}
+		{
+			StageScope stage(*this, "gather animations");
+			gatherAnimations(scene);
+		}
+		gatherSourceStats(filename, first_mesh);
+	}
+
+	scenes.push(scene);
+	scene_memory.push(memory);
+	source_paths.emplace(filename);
+	updateMemoryStats();
+}
+
+
+FBXImporter::SceneMemory FBXImporter::createSceneMemory()
+{
+	SceneMemory memory;
+	memory.slot = FBXMemory::createSlot(arena_scenes);
+	memory.manager = nullptr;
+	if (arena_scenes)
+	{
+		FBXMemory::SlotScope scope(memory.slot);
+		memory.manager = createManager();
+	}
+	return memory;
+}
+
+
+void FBXImporter::destroyScene(FbxScene* scene, const SceneMemory& memory, const char* filename)
+{
+	if (scene) scene->Destroy();
+	if (memory.manager) memory.manager->Destroy();
+
+	const u64 alive = FBXMemory::getSlotStats(memory.slot).current;
+	if (!FBXMemory::destroySlot(memory.slot) && memory.manager)
+	{
+		logWarning("FBX") << filename << ": " << alive << " bytes allocated by the FBX SDK outlive the scene, its arena is kept";
+	}
+}
+
+
+bool FBXImporter::addSource(const char* filename)
+{
+	// files which can not be previewed are loaded right away
+	if (preview_sources && previewSource(filename)) return true;
+
+	const SceneMemory memory = createSceneMemory();
+	FbxManager& manager = memory.manager ? *memory.manager : *fbx_manager;
+	FBXMemory::SlotScope scope(memory.slot);
+	FbxScene* scene;
+	{
+		PathInfo info(filename);
+		StageScope stage(*this, StaticString<64>("load ", info.m_basename));
+		scene = loadScene(manager, filename);
+	}
+	if (!scene)
+	{
+		destroyScene(nullptr, memory, filename);
+		return false;
+	}
+
+	addScene(scene, filename, memory);
+	return true;
+}
+
+
+bool FBXImporter::addSources(Span<const char* const> filenames)
+{
+	if (preview_sources)
+	{
+		Array<const char*> not_previewed(allocator);
+		for (const char* filename : filenames)
+		{
+			if (!previewSource(filename)) not_previewed.push(filename);
+		}
+		if (not_previewed.empty()) return true;
+
+		preview_sources = false;
+		const bool success = addSources(Span<const char* const>(not_previewed.begin(), not_previewed.end()));
+		preview_sources = true;
+		return success;
+	}
+
+	if (!parallel_load || filenames.length() < 2)
+	{
+		for (const char* filename : filenames)
+		{
+			if (!addSource(filename)) return false;
+		}
+		return true;
+	}
+
+	// FbxManager is not thread safe, so each worker gets its own; scenes stay owned by it until clearSources
+	const i32 count = (i32)filenames.length();
+	while (worker_managers.size() < getParallelWorkersCount(count)) worker_managers.push(createManager());
+
+	Array<FbxScene*> loaded(allocator);
+	Array<SceneMemory> memory(allocator);
+	loaded.resize(count);
+	for (i32 i = 0; i < count; ++i) memory.push(createSceneMemory());
+	{
+		StageScope stage(*this, "load all");
+		parallelForWorkers(count, [&](i32 worker, i32 idx) {
+			FbxManager& manager = memory[idx].manager ? *memory[idx].manager : *worker_managers[worker];
+			FBXMemory::SlotScope scope(memory[idx].slot);
+			const u32 prev_thread = stage_thread;
+			stage_thread = worker + 1;
+			{
+				PathInfo info(filenames[idx]);
+				StageScope stage(*this, StaticString<64>("load ", info.m_basename));
+				loaded[idx] = loadScene(manager, filenames[idx]);
+			}
+			stage_thread = prev_thread;
+		});
+	}
+
+	bool success = true;
+	for (i32 i = 0; i < count; ++i)
+	{
+		if (!loaded[i])
+		{
+			success = false;
+			destroyScene(nullptr, memory[i], filenames[i]);
+			continue;
+		}
+		if (success)
+		{
+			addScene(loaded[i], filenames[i], memory[i]);
+		}
+		else
+		{
+			destroyScene(loaded[i], memory[i], filenames[i]);
+		}
+	}
+	return success;
+}
+
+
+bool FBXImporter::writeMaterials()
+{
+	bool success = true;
+	for (const ImportMaterial& material : materials)
+	{
+		if (!material.import) continue;
+
+		StaticString<MAX_PATH_LENGTH> filename(material.fbx->GetName(), ".mat");
+		if (!openOutput(filename))
+		{
+			success = false;
+			continue;
+		}
+
+		writeString("{\n\t\"shader\" : \"pipelines/rigid/rigid.shd\"");
+		if (material.alpha_cutout) writeString(",\n\t\"defines\" : [\"ALPHA_CUTOUT\"]");
+		auto writeTexture = [this](FbxFileTexture* texture, bool srgb) {
+			if (texture)
+			{
+				writeString(",\n\t\"texture\" : { \"source\" : \"");
+				PathInfo info(texture->GetFileName());
+				writeString(texture_dir.data);
+				writeString(info.m_basename);
+				writeString(".");
+				writeString(to_dds ? "dds" : info.m_extension);
+				writeString("\"");
+				if(srgb) writeString(", \"srgb\" : true ");
+				writeString("}");
+			}
+			else
+			{
+				writeString(",\n\t\"texture\" : {");
+				if (srgb) writeString(" \"srgb\" : true ");
+				writeString("}");
+			}
+		};
+
+		FbxProperty diffuse = material.fbx->FindProperty(FbxSurfaceMaterial::sDiffuse);
+		FbxFileTexture* texture = diffuse.GetSrcObject<FbxFileTexture>();
+		writeTexture(texture, true);
+
+		FbxProperty normal = material.fbx->FindProperty(FbxSurfaceMaterial::sNormalMap);
+		texture = normal.GetSrcObject<FbxFileTexture>();
+		writeTexture(texture, false);
+
+		writeString("}");
+
+		if (!closeOutput()) success = false;
+	}
+	return success;
+}
+
+
+bool FBXImporter::findTextureSource(FbxFileTexture& texture, StaticString<MAX_PATH_LENGTH>& out) const
+{
+	out = texture.GetFileName();
+	if (OS::fileExists(out)) return true;
+
+	// exported absolute paths rarely exist on another machine, look next to the source file
+	const int scene_idx = scenes.indexOf(texture.GetScene());
+	if (scene_idx < 0) return false;
+
+	const PathInfo src_info(source_paths[scene_idx]);
+	out = StaticString<MAX_PATH_LENGTH>(src_info.m_dir, texture.GetRelativeFileName());
+	if (OS::fileExists(out)) return true;
+
+	const PathInfo info(texture.GetFileName());
+	out = StaticString<MAX_PATH_LENGTH>(src_info.m_dir, info.m_basename, ".", info.m_extension);
+	return OS::fileExists(out);
+}
+
+
+// the DDS files writeMaterials references, identical sources are decoded and compressed only once
+bool FBXImporter::writeTextures()
+{
+	struct Texture
+	{
+		explicit Texture(IAllocator& allocator)
+			: data(allocator)
+			, dds(allocator)
+		{
+		}
+
+		StaticString<MAX_PATH_LENGTH> src;
+		StaticString<MAX_PATH_LENGTH> dst;
+		bool normal_map;
+		bool valid = false;
+		// earlier texture with the same content and usage, -1 if none
+		int same_as = -1;
+		u64 hash = 0;
+		u32 width = 0;
+		u32 height = 0;
+		TextureCompressor::Format format = TextureCompressor::Format::BC1;
+		// source file, then the decoded mip chain
+		Array<u8> data;
+		Array<u8> dds;
+	};
+
+	Array<Texture> textures(allocator);
+	auto addTexture = [&](FbxFileTexture* texture, bool normal_map) {
+		if (!texture) return;
+
+		const PathInfo info(texture->GetFileName());
+		const StaticString<MAX_PATH_LENGTH> dst(texture_output_dir, info.m_basename, ".dds");
+		for (const Texture& t : textures)
+		{
+			if (equalStrings(t.dst, dst)) return;
+		}
+
+		Texture& t = textures.emplace(allocator);
+		t.dst = dst;
+		t.normal_map = normal_map;
+		if (!findTextureSource(*texture, t.src))
+		{
+			logWarning("FBX") << "Texture " << texture->GetFileName() << " not found";
+			textures.pop();
+		}
+	};
+	for (const ImportMaterial& material : materials)
+	{
+		if (!material.import) continue;
+
+		addTexture(material.fbx->FindProperty(FbxSurfaceMaterial::sDiffuse).GetSrcObject<FbxFileTexture>(), false);
+		addTexture(material.fbx->FindProperty(FbxSurfaceMaterial::sNormalMap).GetSrcObject<FbxFileTexture>(), true);
+	}
+	if (textures.empty()) return true;
+
+	{
+		StageScope stage(*this, "read textures");
+		parallelFor(textures.size(), [&](i32 i) {
+			Texture& t = textures[i];
+			OS::InputFile file;
+			if (!file.open(t.src)) return;
+
+			t.data.resize((int)file.size());
+			const bool read = file.read(t.data.begin(), t.data.size());
+			file.close();
+			if (!read) return;
+
+			CacheHasher hasher;
+			hasher.update(t.data.begin(), t.data.size());
+			t.hash = hasher.hash;
+			t.valid = true;
+		});
+	}
+
+	for (int i = 0; i < textures.size(); ++i)
+	{
+		Texture& t = textures[i];
+		if (!t.valid) continue;
+
+		for (int j = 0; j < i; ++j)
+		{
+			const Texture& prev = textures[j];
+			if (prev.valid && prev.same_as < 0 && prev.hash == t.hash && prev.normal_map == t.normal_map)
+			{
+				t.same_as = j;
+				t.data.clear();
+				break;
+			}
+		}
+	}
+
+	{
+		StageScope stage(*this, "decode textures");
+		parallelFor(textures.size(), [&](i32 i) {
+			Texture& t = textures[i];
+			if (!t.valid || t.same_as >= 0) return;
+
+			Array<u8> rgba(allocator);
+			t.valid = TextureCompressor::decode(Span<const u8>(t.data.begin(), t.data.end()), rgba, t.width, t.height);
+			t.data = static_cast<Array<u8>&&>(rgba);
+			if (!t.valid) return;
+
+			if (t.normal_map) t.format = TextureCompressor::Format::BC5;
+			else if (bc7_textures) t.format = TextureCompressor::Format::BC7;
+			else if (TextureCompressor::hasAlpha(Span<const u8>(t.data.begin(), t.data.end()))) t.format = TextureCompressor::Format::BC3;
+			else t.format = TextureCompressor::Format::BC1;
+			TextureCompressor::generateMips(t.data, t.width, t.height, !t.normal_map);
+		});
+	}
+
+	// block rows of all mips of all textures are spread over the workers
+	struct Job
+	{
+		const Texture* texture;
+		const u8* rgba;
+		u8* out;
+		u32 width;
+		u32 height;
+		u32 first_row;
+		u32 row_count;
+	};
+	static const u32 ROWS_PER_JOB = 16;
+	Array<Job> jobs(allocator);
+	for (Texture& t : textures)
+	{
+		if (!t.valid || t.same_as >= 0) continue;
+
+		const u32 mip_count = TextureCompressor::getMipCount(t.width, t.height);
+		const u32 block_size = TextureCompressor::getBlockSize(t.format);
+		const u32 header_size = TextureCompressor::getDDSHeaderSize(t.format);
+		u32 dds_size = header_size;
+		for (u32 mip = 0; mip < mip_count; ++mip)
+		{
+			const u32 w = TextureCompressor::getMipSize(t.width, mip);
+			const u32 h = TextureCompressor::getMipSize(t.height, mip);
+			dds_size += TextureCompressor::getBlockCount(w) * TextureCompressor::getBlockCount(h) * block_size;
+		}
+		t.dds.resize(dds_size);
+		TextureCompressor::writeDDSHeader(t.format, t.width, t.height, mip_count, t.dds.begin());
+
+		u32 src_offset = 0;
+		u32 dst_offset = header_size;
+		for (u32 mip = 0; mip < mip_count; ++mip)
+		{
+			const u32 w = TextureCompressor::getMipSize(t.width, mip);
+			const u32 h = TextureCompressor::getMipSize(t.height, mip);
+			const u32 row_size = TextureCompressor::getBlockCount(w) * block_size;
+			const u32 rows = TextureCompressor::getBlockCount(h);
+			for (u32 row = 0; row < rows; row += ROWS_PER_JOB)
+			{
+				Job& job = jobs.emplace();
+				job.texture = &t;
+				job.rgba = t.data.begin() + src_offset;
+				job.out = t.dds.begin() + dst_offset + row * row_size;
+				job.width = w;
+				job.height = h;
+				job.first_row = row;
+				job.row_count = minimum(ROWS_PER_JOB, rows - row);
+			}
+			src_offset += w * h * 4;
+			dst_offset += rows * row_size;
+		}
+	}
+
+	{
+		StageScope stage(*this, "compress textures");
+		parallelFor(jobs.size(), [&](i32 i) {
+			const Job& job = jobs[i];
+			TextureCompressor::compressBlocks(job.texture->format, job.rgba, job.width, job.height, job.first_row, job.row_count, job.out);
+		});
+	}
+
+	StageScope stage(*this, "write textures");
+	OS::makePath(texture_output_dir);
+	bool success = true;
+	for (const Texture& t : textures)
+	{
+		const Texture& src = t.same_as < 0 ? t : textures[t.same_as];
+		if (!src.valid)
+		{
+			logError("FBX") << "Failed to convert " << t.src;
+			success = false;
+			continue;
+		}
+
+		OS::OutputFile file;
+		if (!file.open(t.dst))
+		{
+			logError("FBX") << "Failed to create " << t.dst;
+			success = false;
+			continue;
+		}
+		const bool written = file.write(src.dds.begin(), src.dds.size());
+		file.close();
+		if (!written)
+		{
+			logError("FBX") << "Failed to write " << t.dst;
+			success = false;
+			continue;
+		}
+		if (startsWith(t.dst, output_dir))
+		{
+			output_files.emplace(t.dst.data + stringLength(output_dir));
+			output_sizes.push(src.dds.size());
+		}
+	}
+	return success;
+}
+
+
+static float getAnimationDuration(FbxAnimStack* stack)
+{
+	FbxScene* scene = stack->GetScene();
+	FbxTimeSpan time_spawn;
+	const FbxTakeInfo* take_info = scene->GetTakeInfo(stack->GetName());
+	if (take_info)
+	{
+		time_spawn = take_info->mLocalTimeSpan;
+	}
+	else
+	{
+		scene->GetGlobalSettings().GetTimelineDefaultTimeSpan(time_spawn);
+	}
+
+	float start = (float)(time_spawn.GetStart().GetSecondDouble());
+	float end = (float)(time_spawn.GetStop().GetSecondDouble());
+	return end > start ? end - start : 1.0f;
+}
+
+
+bool FBXImporter::writeAnimations()
+{
+	struct Clip
+	{
+		explicit Clip(IAllocator& allocator)
+			: pose(allocator)
+			, parent_scales(allocator)
+			, rotation_errors(allocator)
+			, root_translations(allocator)
+			, root_yaws(allocator)
+		{
+		}
+
+		ImportAnimation* anim;
+		float sampling_period;
+		float fps;
+		float duration;
+		PoseBuffer pose;
+		Array<float> parent_scales;
+		Array<float> rotation_errors;
+		// index in pose.bones, -1 if the clip has no root motion
+		int root_motion_bone = -1;
+		bool additive = false;
+		Array<TranslationKey> root_translations;
+		Array<TranslationKey> root_yaws;
+	};
+
+	struct CompressJob
+	{
+		explicit CompressJob(IAllocator& allocator)
+			: positions(allocator)
+			, rotations(allocator)
+		{
+		}
+
+		i32 clip;
+		i32 bone;
+		bool rotation;
+		Array<TranslationKey> positions;
+		Array<RotationKey> rotations;
+	};
+
+	// a rotation error at a bone moves everything below it, so the allowed angle is the world space error
+	// divided by the distance to the furthest descendant
+	static const float MIN_BONE_REACH = 0.01f;
+	Array<Vec3> bone_positions(allocator);
+	Array<float> bone_reach(allocator);
+	for (FbxNode* bone : bones)
+	{
+		bone_positions.push(toLumixVec3(bone->EvaluateGlobalTransform().GetT()) * mesh_scale);
+		bone_reach.push(0);
+	}
+	for (int i = 0; i < bones.size(); ++i)
+	{
+		for (FbxNode* node = bones[i]->GetParent(); node; node = node->GetParent())
+		{
+			const int parent_idx = getBoneIndex(node);
+			if (parent_idx < 0) continue;
+
+			const float dist = (bone_positions[i] - bone_positions[parent_idx]).length();
+			bone_reach[parent_idx] = maximum(bone_reach[parent_idx], dist);
+			// skinned vertices of a bone extend about as far as the bone is long
+			if (node == bones[i]->GetParent()) bone_reach[i] = maximum(bone_reach[i], dist);
+		}
+	}
+
+	for (FileStats& stats : source_stats) stats.animation_frames = 0;
+
+	// up axis of the sources, root motion is what happens in the plane perpendicular to it
+	Vec3 up(0, 1, 0);
+	switch (orientation)
+	{
+		case Orientation::Y_UP: up = {0, 1, 0}; break;
+		case Orientation::Z_UP: up = {0, 0, 1}; break;
+		case Orientation::Z_MINUS_UP: up = {0, 0, -1}; break;
+		case Orientation::X_MINUS_UP: up = {-1, 0, 0}; break;
+	}
+	Array<Vec3> root_translations(allocator);
+	Array<Vec3> root_yaws(allocator);
+
+	// sampling goes through the FBX SDK, which is not thread safe, so it is serial
+	Array<Clip> clips(allocator);
+	for (ImportAnimation& anim : animations)
+	{
+		if (!anim.import) continue;
+
+		FbxAnimStack* stack = anim.fbx;
+		FbxScene* scene = stack->GetScene();
+		scene->SetCurrentAnimationStack(stack);
+
+		FbxTime::EMode mode = scene->GetGlobalSettings().GetTimeMode();
+		float scene_frame_rate =
+			(float)((mode == FbxTime::eCustom) ? scene->GetGlobalSettings().GetCustomFrameRate()
+											   : FbxTime::GetFrameRate(mode));
+
+		Clip& clip = clips.emplace(allocator);
+		clip.anim = &anim;
+		clip.fps = scene_frame_rate;
+		clip.sampling_period = 1.0f / scene_frame_rate;
+
+		clip.duration = getAnimationDuration(stack);
+
+		const ImportAnimation* reference = nullptr;
+		if (!anim.additive_reference.empty() && !extended_formats)
+		{
+			logWarning("FBX") << anim.output_filename << ": additive clips need extended formats, baking it as a regular clip";
+		}
+		else if (!anim.additive_reference.empty() && !equalStrings(anim.additive_reference, anim.output_filename))
+		{
+			for (const ImportAnimation& other : animations)
+			{
+				if (equalStrings(other.output_filename, anim.additive_reference)) reference = &other;
+			}
+			if (!reference) logWarning("FBX") << anim.output_filename << ": additive reference " << anim.additive_reference << " not found";
+		}
+		clip.additive = reference != nullptr;
+		PoseBuffer reference_pose(allocator);
+		HashMap<u32, FbxNode*> reference_bones(allocator);
+		if (reference)
+		{
+			for (FbxNode* node : scene_bones[scenes.indexOf(reference->fbx->GetScene())])
+			{
+				reference_bones.insert(crc32(node->GetName()), node);
+			}
+		}
+
+		FbxAnimEvaluator* eval = scene->GetAnimationEvaluator();
+		FbxAnimLayer* layer = stack->GetMember<FbxAnimLayer>();
+		const int scene_idx = scenes.indexOf(scene);
+		for (FbxNode* bone : scene_bones[scene_idx])
+		{
+			// a bone which is not animated can still differ from the reference, bones missing in the reference are skipped
+			const bool animated = bone->LclTranslation.GetCurveNode(layer) || bone->LclRotation.GetCurveNode(layer);
+			FbxNode* reference_bone = nullptr;
+			if (reference)
+			{
+				auto iter = reference_bones.find(crc32(bone->GetName()));
+				if (iter.isValid() && equalStrings(iter.value()->GetName(), bone->GetName())) reference_bone = iter.value();
+				if (!reference_bone && animated)
+				{
+					logWarning("FBX") << anim.output_filename << ": animated bone " << bone->GetName() << " is not in additive reference "
+									  << reference->output_filename << ", skipping it";
+				}
+			}
+			if (reference_bone || (!reference && animated))
+			{
+				if (reference_bone) reference_pose.bones.push(reference_bone);
+				clip.pose.bones.push(bone);
+				float parent_scale = bone->GetParent() ? (float)bone->GetParent()->EvaluateGlobalTransform().GetS().mData[0] : 1;
+				clip.parent_scales.push(parent_scale);
+				const float reach = maximum(bone_reach[getBoneIndex(bone)], MIN_BONE_REACH);
+				clip.rotation_errors.push(animation_max_error / reach);
+			}
+		}
+
+		const int frames = int((clip.duration / clip.sampling_period) + 0.5f);
+		clip.pose.sample(eval, frames + 1, clip.sampling_period);
+
+		if (reference)
+		{
+			FbxAnimStack* reference_stack = reference->fbx;
+			FbxScene* reference_scene = reference_stack->GetScene();
+			reference_scene->SetCurrentAnimationStack(reference_stack);
+			const float reference_period = frames > 0 ? getAnimationDuration(reference_stack) / frames : 0;
+			reference_pose.sample(reference_scene->GetAnimationEvaluator(), anim.additive_pose ? 1 : frames + 1, reference_period);
+			makeAdditive(clip.pose, reference_pose);
+
+			// bones which match the reference within the error are left out, they are identity at runtime
+			const int bone_count = clip.pose.bones.size();
+			for (int i = bone_count - 1; i >= 0; --i)
+			{
+				float max_distance = 0;
+				float min_dot = 1;
+				for (const Vec3& t : clip.pose.getTranslations(i)) max_distance = maximum(max_distance, t.length());
+				for (const Quat& rot : clip.pose.getRotations(i)) min_dot = minimum(min_dot, fabsf(rot.w));
+				const float max_angle = 2 * acosf(minimum(min_dot, 1.0f));
+				if (max_distance * clip.parent_scales[i] > animation_max_error / mesh_scale || max_angle > clip.rotation_errors[i]) continue;
+
+				clip.pose.removeBone(i);
+				clip.parent_scales.erase(i);
+				clip.rotation_errors.erase(i);
+			}
+			logInfo("FBX") << anim.output_filename << ": additive to " << reference->output_filename << ", "
+						   << clip.pose.bones.size() << " of " << bone_count << " bones differ";
+		}
+
+		if (!anim.root_motion_bone.empty() && !extended_formats)
+		{
+			logWarning("FBX") << anim.output_filename << ": root motion needs extended formats, the bone keeps its motion";
+		}
+		else if (!anim.root_motion_bone.empty())
+		{
+			for (int i = 0; i < clip.pose.bones.size(); ++i)
+			{
+				if (equalStrings(clip.pose.bones[i]->GetName(), anim.root_motion_bone)) clip.root_motion_bone = i;
+			}
+			if (clip.root_motion_bone < 0)
+			{
+				logWarning("FBX") << anim.output_filename << ": root motion bone " << anim.root_motion_bone << " is not animated";
+			}
+		}
+		if (clip.root_motion_bone >= 0)
+		{
+			// the bone's own tracks lose the motion and usually reduce to a few keys
+			const int bone = clip.root_motion_bone;
+			extractRootMotion(clip.pose, bone, up, root_translations, root_yaws);
+			const Span<const Vec3> translations(root_translations.begin(), root_translations.end());
+			const Span<const Vec3> yaws(root_yaws.begin(), root_yaws.end());
+			compressPositions(
+				clip.root_translations, translations, clip.sampling_period, animation_max_error / mesh_scale, clip.parent_scales[bone]);
+			compressPositions(clip.root_yaws, yaws, clip.sampling_period, clip.rotation_errors[bone], 1);
+		}
+		source_stats[scene_idx].animation_frames += frames + 1;
+	}
+
+	// compression only reads the pose buffers, one job per clip, bone and channel
+	Array<CompressJob> jobs(allocator);
+	for (int i = 0; i < clips.size(); ++i)
+	{
+		for (int j = 0; j < clips[i].pose.bones.size(); ++j)
+		{
+			for (int k = 0; k < 2; ++k)
+			{
+				CompressJob& job = jobs.emplace(allocator);
+				job.clip = i;
+				job.bone = j;
+				job.rotation = k == 1;
+			}
+		}
+	}
+
+	parallelFor(jobs.size(), [&](i32 idx) {
+		CompressJob& job = jobs[idx];
+		const Clip& clip = clips[job.clip];
+		if (job.rotation)
+		{
+			compressRotations(job.rotations, clip.pose.getRotations(job.bone), clip.sampling_period, clip.rotation_errors[job.bone]);
+		}
+		else
+		{
+			// keys are scaled by mesh_scale when written
+			const float max_error = animation_max_error / mesh_scale;
+			compressPositions(
+				job.positions, clip.pose.getTranslations(job.bone), clip.sampling_period, max_error, clip.parent_scales[job.bone]);
+		}
+	});
+
+	const bool quantized = animation_format != AnimationFormat::FLOAT && extended_formats;
+	if (animation_format != AnimationFormat::FLOAT && !extended_formats && !clips.empty())
+	{
+		logWarning("FBX") << "Quantized animation keys need extended formats, writing float keys";
+	}
+	const u32 rotation_bits = animation_format == AnimationFormat::QUANTIZED_32 ? 10 : 15;
+	auto writeFrames = [&](auto& keys) {
+		write(keys.size());
+		if (!quantized)
+		{
+			for (const auto& key : keys) write(key.frame);
+			return;
+		}
+		// deltas from the previous key as LEB128, usually a single byte
+		u16 prev = 0;
+		for (const auto& key : keys)
+		{
+			u32 delta = key.frame - prev;
+			prev = key.frame;
+			do
+			{
+				u8 byte = delta & 0x7f;
+				delta >>= 7;
+				if (delta) byte |= 0x80;
+				write(byte);
+			} while (delta);
+		}
+	};
+
+	// quantization is applied to the fitted keys, the errors are reported on top of animation_max_error
+	float max_translation_error = 0;
+	float max_rotation_error = 0;
+	Array<Vec3> translations(allocator);
+
+	// jobs are in clip, bone, channel order, so the files come out the same as when compressed serially
+	int job_idx = 0;
+	bool success = true;
+	for (const Clip& clip : clips)
+	{
+		StaticString<MAX_PATH_LENGTH> filename(clip.anim->output_filename, ".ani");
+		if (!openOutput(filename))
+		{
+			job_idx += clip.pose.bones.size() * 2;
+			success = false;
+			continue;
+		}
+		Animation::Header header;
+		header.magic = Animation::HEADER_MAGIC;
+		header.version = quantized ? ANIMATION_VERSION_QUANTIZED : 3;
+		if (clip.root_motion_bone >= 0 || clip.additive) header.version = ANIMATION_VERSION_FLAGS;
+		header.fps = (u32)(clip.fps + 0.5f);
+		write(header);
+		if (header.version != 3)
+		{
+			u32 flags = animation_format == AnimationFormat::QUANTIZED_32 ? ANIMATION_ROTATIONS_32BIT_FLAG : 0;
+			if (!quantized) flags |= ANIMATION_FLOAT_KEYS_FLAG;
+			if (clip.additive) flags |= ANIMATION_ADDITIVE_FLAG;
+			write(flags);
+		}
+
+		write(clip.root_motion_bone);
+		write(int(clip.duration / clip.sampling_period));
+
+		write(clip.pose.bones.size());
+		for (FbxNode* bone : clip.pose.bones)
+		{
+			u32 name_hash = crc32(bone->GetName());
+			write(name_hash);
+
+			const Array<TranslationKey>& positions = jobs[job_idx++].positions;
+			writeFrames(positions);
+			translations.clear();
+			for (const TranslationKey& key : positions)
+			{
+				// TODO check this in isValid function
+				// assert(scale > 0.99f && scale < 1.01f);
+				translations.push(fixOrientation(key.pos * mesh_scale));
+			}
+			if (quantized)
+			{
+				// range of the track, a key is decoded as min + value / 65535 * extent
+				Vec3 min = translations.empty() ? Vec3(0, 0, 0) : translations[0];
+				Vec3 max = min;
+				for (const Vec3& pos : translations)
+				{
+					min.x = minimum(min.x, pos.x);
+					min.y = minimum(min.y, pos.y);
+					min.z = minimum(min.z, pos.z);
+					max.x = maximum(max.x, pos.x);
+					max.y = maximum(max.y, pos.y);
+					max.z = maximum(max.z, pos.z);
+				}
+				const Vec3 extent = max - min;
+				write(min);
+				write(extent);
+				for (const Vec3& pos : translations)
+				{
+					const u16 packed[3] = {
+						toUnorm16(pos.x, min.x, extent.x), toUnorm16(pos.y, min.y, extent.y), toUnorm16(pos.z, min.z, extent.z)};
+					write(packed);
+					const Vec3 decoded(min.x + packed[0] / 65535.0f * extent.x,
+						min.y + packed[1] / 65535.0f * extent.y,
+						min.z + packed[2] / 65535.0f * extent.z);
+					max_translation_error = maximum(max_translation_error, (decoded - pos).length());
+				}
+			}
+			else
+			{
+				for (const Vec3& pos : translations) write(pos);
+			}
+
+			const Array<RotationKey>& rotations = jobs[job_idx++].rotations;
+			writeFrames(rotations);
+			for (const RotationKey& key : rotations)
+			{
+				const Quat rot = fixOrientation(key.rot);
+				if (!quantized)
+				{
+					write(rot);
+					continue;
+				}
+
+				const u64 packed = packSmallestThree(rot, rotation_bits);
+				if (animation_format == AnimationFormat::QUANTIZED_32)
+				{
+					write(u32(packed));
+				}
+				else
+				{
+					const u16 words[3] = {u16(packed), u16(packed >> 16), u16(packed >> 32)};
+					write(words);
+				}
+				max_rotation_error = maximum(max_rotation_error, getAngle(rot, unpackSmallestThree(packed, rotation_bits)));
+			}
+		}
+
+		// offsets from the first frame in the model's XZ plane and yaw in radians about Y, floats in all formats
+		if (clip.root_motion_bone >= 0)
+		{
+			writeFrames(clip.root_translations);
+			for (const TranslationKey& key : clip.root_translations)
+			{
+				const Vec3 pos = fixOrientation(key.pos * mesh_scale);
+				write(pos.x);
+				write(pos.z);
+			}
+			writeFrames(clip.root_yaws);
+			for (const TranslationKey& key : clip.root_yaws) write(key.pos.x);
+		}
+		if (!closeOutput()) success = false;
+	}
+
+	if (quantized && !clips.empty())
+	{
+		logInfo("FBX") << "Max animation quantization error - translation: " << max_translation_error
+					   << ", rotation: " << max_rotation_error * 180 / PI << " deg";
+	}
+	return success;
+}
+
+
+bool FBXImporter::isSkinned(FbxMesh* mesh) const
+{
+	return !ignore_skeleton && mesh->GetDeformerCount(FbxDeformer::EDeformerType::eSkin) > 0;
+}
+
+
+int FBXImporter::getAttributes(Span<VertexAttribute> attributes) const
+{
+	int count = 0;
+	auto add = [&](i32 semantic, AttributeType type, u8 components, bool normalized) {
+		ASSERT(count < (int)attributes.length());
+		attributes[count++] = {semantic, type, components, normalized};
+	};
+
+	if (vertex_position_format == PositionFormat::UNORM16) add(SEMANTIC_POSITION, AttributeType::U16, 4, true);
+	else add(SEMANTIC_POSITION, AttributeType::FLOAT, 3, false);
+
+	const bool octahedral = vertex_normal_format == NormalFormat::OCTAHEDRAL;
+	add(SEMANTIC_NORMAL, octahedral ? AttributeType::I16 : AttributeType::U8, octahedral ? 2 : 4, true);
+	if (vertex_tangents)
+	{
+		add(SEMANTIC_TANGENT, octahedral ? AttributeType::I16 : AttributeType::U8, octahedral ? 2 : 4, true);
+	}
+
+	if (vertex_uvs)
+	{
+		switch (vertex_uv_format)
+		{
+			case UVFormat::FLOAT: add(SEMANTIC_TEXCOORD0, AttributeType::FLOAT, 2, false); break;
+			case UVFormat::HALF: add(SEMANTIC_TEXCOORD0, AttributeType::HALF, 2, false); break;
+			case UVFormat::UNORM16: add(SEMANTIC_TEXCOORD0, AttributeType::U16, 2, true); break;
+		}
+	}
+	// TODO
+	//if (mesh->GetElementVertexColorCount() > 0) ...
+
+	if (vertex_skin)
+	{
+		if (vertex_skin_format == SkinFormat::UNORM8)
+		{
+			add(SEMANTIC_INDICES, AttributeType::U8, 4, false);
+			add(SEMANTIC_WEIGHTS, AttributeType::U8, 4, true);
+		}
+		else
+		{
+			add(SEMANTIC_INDICES, AttributeType::I16, 4, false);
+			add(SEMANTIC_WEIGHTS, AttributeType::FLOAT, 4, false);
+		}
+	}
+	return count;
+}
+
+
+// default formats are implied by attribute semantics, anything else has to be described in the file
+bool FBXImporter::hasAttributeTypes() const
+{
+	return vertex_position_format != PositionFormat::FLOAT || vertex_uv_format != UVFormat::FLOAT
+		   || vertex_normal_format != NormalFormat::PACKED_U8 || vertex_skin_format != SkinFormat::FLOAT;
+}
+
+
+static int getAttributeSize(const FBXImporter::VertexAttribute& attr)
+{
+	switch (attr.type)
+	{
+		case FBXImporter::AttributeType::FLOAT: return 4 * attr.components;
+		case FBXImporter::AttributeType::HALF:
+		case FBXImporter::AttributeType::I16:
+		case FBXImporter::AttributeType::U16: return 2 * attr.components;
+		case FBXImporter::AttributeType::U8: return attr.components;
+	}
+	ASSERT(false);
+	return 0;
+}
+
+
+int FBXImporter::getVertexSize() const
+{
+	VertexAttribute attributes[MAX_ATTRIBUTES];
+	const int count = getAttributes(Span(attributes));
+	int size = 0;
+	for (int i = 0; i < count; ++i) size += getAttributeSize(attributes[i]);
+	return size;
+}
+
+
+int FBXImporter::getAttributeOffset(i32 semantic) const
+{
+	VertexAttribute attributes[MAX_ATTRIBUTES];
+	const int count = getAttributes(Span(attributes));
+	int offset = 0;
+	for (int i = 0; i < count; ++i)
+	{
+		if (attributes[i].semantic == semantic) return offset;
+		offset += getAttributeSize(attributes[i]);
+	}
+	return -1;
+}
+
+
+void FBXImporter::fillSkinInfo(Array<Skin>& skinning, const FbxMesh* mesh) const
+{
+	skinning.resize(mesh->GetControlPointsCount());
+
+	FbxDeformer* deformer = mesh->GetDeformer(0, FbxDeformer::EDeformerType::eSkin);
+	auto* skin = static_cast<FbxSkin*>(deformer);
+	for (int i = 0; i < skin->GetClusterCount(); ++i)
+	{
+		FbxCluster* cluster = skin->GetCluster(i);
+		int joint = getBoneIndex(cluster->GetLink());
+		const int* cp_indices = cluster->GetControlPointIndices();
+		const double* weights = cluster->GetControlPointWeights();
+		for (int j = 0; j < cluster->GetControlPointIndicesCount(); ++j)
+		{
+			int idx = cp_indices[j];
+			float weight = (float)weights[j];
+			Skin& s = skinning[idx];
+			if (s.count < 4)
+			{
+				s.weights[s.count] = weight;
+				s.joints[s.count] = joint;
+				++s.count;
+			}
+			else
+			{
+				int min = 0;
+				for (int m = 1; m < 4; ++m)
+				{
+					if (s.weights[m] < s.weights[min]) min = m;
+				}
+
+				if (s.weights[min] < weight)
+				{
+					s.weights[min] = weight;
+					s.joints[min] = joint;
+				}
+			}
+		}
+	}
+
+	for (Skin& s : skinning)
+	{
+		float sum = 0;
+		for (float w : s.weights) sum += w;
+		if (sum == 0) continue;
+		for (float& w : s.weights) w /= sum;
+	}
+}
+
+
+Vec3 FBXImporter::fixOrientation(const Vec3& v) const
+{
+	switch (orientation)
+	{
+		case Orientation::Y_UP: return Vec3(v.x, v.y, v.z);
+		case Orientation::Z_UP: return Vec3(v.x, v.z, -v.y);
+		case Orientation::Z_MINUS_UP: return Vec3(v.x, -v.z, v.y);
+		case Orientation::X_MINUS_UP: return Vec3(v.y, -v.x, v.z);
+	}
+	ASSERT(false);
+	return Vec3(v.x, v.y, v.z);
+}
+
+
+Quat FBXImporter::fixOrientation(const Quat& v) const
+{
+	switch (orientation)
+	{
+		case Orientation::Y_UP: return Quat(v.x, v.y, v.z, v.w);
+		case Orientation::Z_UP: return Quat(v.x, v.z, -v.y, v.w);
+		case Orientation::Z_MINUS_UP: return Quat(v.x, -v.z, v.y, v.w);
+		case Orientation::X_MINUS_UP: return Quat(v.y, -v.x, v.z, v.w);
+	}
+	ASSERT(false);
+	return Quat(v.x, v.y, v.z, v.w);
+}
+
+
+void FBXImporter::buildGeometry(ImportMesh& import_mesh)
+{
+	Array<Skin> skinning(allocator);
+	FbxMesh* mesh = import_mesh.fbx;
+	bool is_skinned = isSkinned(mesh);
+
+	Matrix transform_matrix = Matrix::IDENTITY;
+	FbxNode* mesh_node = mesh->GetNode();
+	FbxAMatrix geometry_matrix(
+		mesh_node->GetGeometricTranslation(FbxNode::eSourcePivot),
+		mesh_node->GetGeometricRotation(FbxNode::eSourcePivot),
+		mesh_node->GetGeometricScaling(FbxNode::eSourcePivot));
+	if (is_skinned)
+	{
+		fillSkinInfo(skinning, mesh);
+
+		FbxDeformer* deformer = mesh->GetDeformer(0, FbxDeformer::EDeformerType::eSkin);
+		auto* skin = static_cast<FbxSkin*>(deformer);
+		auto* cluster = skin->GetCluster(0);
+		FbxAMatrix mtx;
+		cluster->GetTransformMatrix(mtx);
+		mtx *= geometry_matrix;
+		transform_matrix = toLumix(mtx);
+	}
+	else
+	{
+		FbxAMatrix node_global_mtx = mesh_node->EvaluateGlobalTransform();
+		transform_matrix = toLumix(node_global_mtx * geometry_matrix);
+		if (center_mesh)
+		{
+			transform_matrix.setTranslation({0, 0, 0});
+		}
+	}
+
+	// rigid meshes in a skinned model follow the closest bone above them, or the first bone if there is none
+	Skin rigid;
+	rigid.weights[0] = 1;
+	rigid.count = 1;
+	for (FbxNode* node = mesh_node->GetParent(); node; node = node->GetParent())
+	{
+		const int bone = getBoneIndex(node);
+		if (bone < 0) continue;
+		rigid.joints[0] = (i16)bone;
+		break;
+	}
+	bool has_uvs = mesh->GetElementUVCount() > 0;
+	FbxStringList uv_set_name_list;
+	const char* uv_set_name = nullptr;
+	if (has_uvs)
+	{
+		mesh->GetUVSetNames(uv_set_name_list);
+		uv_set_name = uv_set_name_list.GetStringAt(0);
+	}
+	const FbxGeometryElementTangent* tangents = mesh->GetElementTangentCount() > 0 ? mesh->GetElementTangent(0) : nullptr;
+
+	auto transformPosition = [&](const FbxVector4& cp) {
+		// premultiply control points here, so we can have constantly-scaled meshes without scale in bones
+		Vec3 pos = transform_matrix.transformPoint(toLumixVec3(cp)) * mesh_scale;
+		return fixOrientation(pos);
+	};
+	auto getPosition = [&](int control_point) { return transformPosition(mesh->GetControlPointAt(control_point)); };
+	auto getUV = [&](int polygon, int vertex) {
+		bool unmapped;
+		FbxVector2 uv;
+		mesh->GetPolygonVertexUV(polygon, vertex, uv_set_name, uv, unmapped);
+		return Vec2((float)uv.mData[0], 1 - (float)uv.mData[1]);
+	};
+	auto getDirection = [&](const FbxVector4& v) {
+		Vec3 dir = transform_matrix.transformVector(toLumixVec3(v));
+		dir.normalize();
+		return fixOrientation(dir);
+	};
+
+	auto usesPolygon = [&](int polygon) {
+		return import_mesh.material_index < 0 || getPolygonMaterial(mesh, polygon) == import_mesh.material_index;
+	};
+
+	// dequantization ranges have to be known before any vertex is encoded
+	const bool quantize_positions = vertex_position_format == PositionFormat::UNORM16;
+	const bool quantize_uvs = has_uvs && vertex_uv_format == UVFormat::UNORM16;
+	import_mesh.position_offset = {0, 0, 0};
+	import_mesh.position_scale = {1, 1, 1};
+	import_mesh.uv_offset = {0, 0};
+	import_mesh.uv_scale = {1, 1};
+	if (quantize_positions || quantize_uvs)
+	{
+		Vec3 min_pos(FLT_MAX, FLT_MAX, FLT_MAX);
+		Vec3 max_pos(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+		Vec2 min_uv(FLT_MAX, FLT_MAX);
+		Vec2 max_uv(-FLT_MAX, -FLT_MAX);
+		for (int i = 0, c = mesh->GetPolygonCount(); i < c; ++i)
+		{
+			if (!usesPolygon(i)) continue;
+
+			for (int j = 0; j < mesh->GetPolygonSize(i); ++j)
+			{
+				if (quantize_positions)
+				{
+					const Vec3 pos = getPosition(mesh->GetPolygonVertex(i, j));
+					min_pos = {minimum(min_pos.x, pos.x), minimum(min_pos.y, pos.y), minimum(min_pos.z, pos.z)};
+					max_pos = {maximum(max_pos.x, pos.x), maximum(max_pos.y, pos.y), maximum(max_pos.z, pos.z)};
+				}
+				if (quantize_uvs)
+				{
+					const Vec2 uv = getUV(i, j);
+					min_uv = {minimum(min_uv.x, uv.x), minimum(min_uv.y, uv.y)};
+					max_uv = {maximum(max_uv.x, uv.x), maximum(max_uv.y, uv.y)};
+				}
+			}
+		}
+		if (quantize_positions && min_pos.x <= max_pos.x)
+		{
+			import_mesh.position_offset = min_pos;
+			import_mesh.position_scale = max_pos - min_pos;
+		}
+		if (quantize_uvs && min_uv.x <= max_uv.x)
+		{
+			import_mesh.uv_offset = min_uv;
+			import_mesh.uv_scale = {max_uv.x - min_uv.x, max_uv.y - min_uv.y};
+		}
+	}
+
+	const u32 vertex_size = (u32)getVertexSize();
+	u32 corner_count = 0;
+	for (int i = 0, c = mesh->GetPolygonCount(); i < c; ++i)
+	{
+		if (usesPolygon(i)) corner_count += 3 * maximum(mesh->GetPolygonSize(i) - 2, 0);
+	}
+	OutputMemoryStream& vertices = import_mesh.vertex_data;
+	Array<u32>& indices = import_mesh.indices;
+	import_mesh.blend_shapes.clear();
+	// blend shapes move control points, so vertices of different control points must not be welded
+	const bool has_blend_shapes =
+		import_blend_shapes && extended_formats && mesh->GetDeformerCount(FbxDeformer::EDeformerType::eBlendShape) > 0;
+	Array<u32> vertex_control_points(allocator);
+	Array<u32> vertex_polygon_vertices(allocator);
+	vertices.clear();
+	vertices.reserve(corner_count * vertex_size);
+	indices.clear();
+	indices.reserve(corner_count);
+	import_mesh.aabb = {{FLT_MAX, FLT_MAX, FLT_MAX}, {-FLT_MAX, -FLT_MAX, -FLT_MAX}};
+	import_mesh.radius_squared = 0;
+
+	// open addressing, values are vertex index + 1, 0 is an empty slot
+	u32 table_size = 1;
+	while (table_size < corner_count * 2) table_size <<= 1;
+	Array<u32> table(allocator);
+	table.resize(table_size);
+	memset(table.begin(), 0, table_size * sizeof(table[0]));
+
+	QuantizationError& error = quantization_error;
+	u8 vertex[64];
+	ASSERT(vertex_size <= sizeof(vertex));
+	// polygons are triangulated here, so meshes which are not imported are never touched
+	const bool triangle_mesh = mesh->IsTriangleMesh();
+	PolygonTriangulator triangulator(allocator);
+	Array<int> corners(allocator);
+	for (int i = 0, c = mesh->GetPolygonCount(); i < c; ++i)
+	{
+		if (!usesPolygon(i)) continue;
+
+		corners.clear();
+		if (triangle_mesh)
+		{
+			corners.push(0);
+			corners.push(1);
+			corners.push(2);
+		}
+		else
+		{
+			triangulator.triangulate(mesh, i, corners);
+		}
+
+		const int polygon_start = mesh->GetPolygonVertexIndex(i);
+		for (int j : corners)
+		{
+			const int polygon_vertex = polygon_start + j;
+			u8* cursor = vertex;
+			auto put = [&cursor](const auto& value) {
+				memcpy(cursor, &value, sizeof(value));
+				cursor += sizeof(value);
+			};
+			auto putDirection = [&](const Vec3& dir, float& max_error) {
+				if (vertex_normal_format == NormalFormat::OCTAHEDRAL)
+				{
+					i16 encoded[2];
+					encodeOctahedral(dir, encoded);
+					put(encoded);
+					max_error = maximum(max_error, getAngle(dir, decodeOctahedral(encoded)));
+				}
+				else
+				{
+					const u32 packed = packF4u(dir);
+					put(packed);
+					Vec3 decoded = unpackF4u(packed);
+					decoded.normalize();
+					max_error = maximum(max_error, getAngle(dir, decoded));
+				}
+			};
+
+			int vertex_index = mesh->GetPolygonVertex(i, j);
+			const Vec3 pos = getPosition(vertex_index);
+			if (quantize_positions)
+			{
+				const Vec3& offset = import_mesh.position_offset;
+				const Vec3& scale = import_mesh.position_scale;
+				const u16 encoded[4] = {
+					toUnorm16(pos.x, offset.x, scale.x), toUnorm16(pos.y, offset.y, scale.y), toUnorm16(pos.z, offset.z, scale.z), 0};
+				put(encoded);
+				const Vec3 decoded(offset.x + encoded[0] / 65535.0f * scale.x,
+					offset.y + encoded[1] / 65535.0f * scale.y,
+					offset.z + encoded[2] / 65535.0f * scale.z);
+				error.position = maximum(error.position, (decoded - pos).length());
+			}
+			else
+			{
+				put(pos);
+			}
+
+			FbxVector4 fbx_normal;
+			mesh->GetPolygonVertexNormal(i, j, fbx_normal);
+			putDirection(getDirection(fbx_normal), error.normal);
+			// the layout is shared by all meshes, attributes a mesh does not have get default values
+			if (vertex_tangents)
+			{
+				const Vec3 tangent = tangents ? getDirection(getLayerElement(tangents, vertex_index, polygon_vertex)) : Vec3(1, 0, 0);
+				putDirection(tangent, error.tangent);
+			}
+
+			if (vertex_uvs)
+			{
+				const Vec2 uv = has_uvs ? getUV(i, j) : Vec2(0, 0);
+				switch (vertex_uv_format)
+				{
+					case UVFormat::FLOAT: put(uv); break;
+					case UVFormat::HALF:
+					{
+						const u16 encoded[2] = {floatToHalf(uv.x), floatToHalf(uv.y)};
+						put(encoded);
+						error.uv = maximum(error.uv, maximum(fabsf(halfToFloat(encoded[0]) - uv.x), fabsf(halfToFloat(encoded[1]) - uv.y)));
+						break;
+					}
+					case UVFormat::UNORM16:
+					{
+						const Vec2& offset = import_mesh.uv_offset;
+						const Vec2& scale = import_mesh.uv_scale;
+						const u16 encoded[2] = {toUnorm16(uv.x, offset.x, scale.x), toUnorm16(uv.y, offset.y, scale.y)};
+						put(encoded);
+						const float du = fabsf(offset.x + encoded[0] / 65535.0f * scale.x - uv.x);
+						const float dv = fabsf(offset.y + encoded[1] / 65535.0f * scale.y - uv.y);
+						error.uv = maximum(error.uv, maximum(du, dv));
+						break;
+					}
+				}
+			}
+			if (vertex_skin)
+			{
+				const Skin& skin = is_skinned ? skinning[vertex_index] : rigid;
+				if (vertex_skin_format == SkinFormat::UNORM8)
+				{
+					u8 joints[4];
+					u8 weights[4];
+					int sum = 0;
+					int largest = 0;
+					for (int k = 0; k < 4; ++k)
+					{
+						joints[k] = (u8)skin.joints[k];
+						weights[k] = (u8)floorf(clamp(skin.weights[k], 0.0f, 1.0f) * 255.0f + 0.5f);
+						sum += weights[k];
+						if (skin.weights[k] > skin.weights[largest]) largest = k;
+					}
+					// rounding must not change the sum, or skinned vertices would scale
+					if (sum > 0) weights[largest] = u8(weights[largest] + 255 - sum);
+					for (int k = 0; k < 4; ++k)
+					{
+						error.weight = maximum(error.weight, fabsf(weights[k] / 255.0f - skin.weights[k]));
+					}
+					put(joints);
+					put(weights);
+				}
+				else
+				{
+					put(skin.joints);
+					put(skin.weights);
+				}
+			}
+			ASSERT(u32(cursor - vertex) == vertex_size);
+
+			// weld on the final bytes, so only vertices which are identical in the file are merged
+			u32 slot = crc32(vertex, vertex_size) & (table_size - 1);
+			for (;;)
+			{
+				const u32 value = table[slot];
+				if (value == 0)
+				{
+					const u32 idx = u32(vertices.getPos() / vertex_size);
+					table[slot] = idx + 1;
+					vertices.write(vertex, vertex_size);
+					indices.push(idx);
+					if (has_blend_shapes)
+					{
+						vertex_control_points.push(vertex_index);
+						vertex_polygon_vertices.push(polygon_vertex);
+					}
+
+					AABB& aabb = import_mesh.aabb;
+					aabb.min.x = minimum(aabb.min.x, pos.x);
+					aabb.min.y = minimum(aabb.min.y, pos.y);
+					aabb.min.z = minimum(aabb.min.z, pos.z);
+					aabb.max.x = maximum(aabb.max.x, pos.x);
+					aabb.max.y = maximum(aabb.max.y, pos.y);
+					aabb.max.z = maximum(aabb.max.z, pos.z);
+					import_mesh.radius_squared = maximum(import_mesh.radius_squared, pos.squaredLength());
+					break;
+				}
+				if (memcmp(vertices.getData() + (value - 1) * vertex_size, vertex, vertex_size) == 0
+					&& (!has_blend_shapes || vertex_control_points[value - 1] == (u32)vertex_index))
+				{
+					indices.push(value - 1);
+					break;
+				}
+				slot = (slot + 1) & (table_size - 1);
+			}
+		}
+	}
+
+	if (!has_blend_shapes) return;
+
+	const float min_distance = sqrtf(import_mesh.radius_squared) * BLEND_SHAPE_MIN_DISTANCE;
+	const FbxGeometryElementNormal* normals = mesh->GetElementNormalCount() > 0 ? mesh->GetElementNormal(0) : nullptr;
+	for (int i = 0, c = mesh->GetDeformerCount(FbxDeformer::EDeformerType::eBlendShape); i < c; ++i)
+	{
+		auto* blend_shape = static_cast<FbxBlendShape*>(mesh->GetDeformer(i, FbxDeformer::EDeformerType::eBlendShape));
+		for (int j = 0, channel_count = blend_shape->GetBlendShapeChannelCount(); j < channel_count; ++j)
+		{
+			// in-between targets are not supported, the last one is the channel at full weight
+			FbxBlendShapeChannel* channel = blend_shape->GetBlendShapeChannel(j);
+			const int target_count = channel->GetTargetShapeCount();
+			if (target_count == 0) continue;
+			if (target_count > 1)
+			{
+				logWarning("FBX") << "Blend shape channel " << channel->GetName() << " has " << target_count - 1
+								  << " in-between targets, only the full weight target is imported";
+			}
+			FbxShape* shape = channel->GetTargetShape(target_count - 1);
+			const FbxGeometryElementNormal* shape_normals =
+				normals && shape->GetElementNormalCount() > 0 ? shape->GetElementNormal(0) : nullptr;
+
+			BlendShape& target = import_mesh.blend_shapes.emplace(allocator);
+			target.name = channel->GetName();
+			for (int v = 0; v < vertex_control_points.size(); ++v)
+			{
+				const int control_point = vertex_control_points[v];
+				const int polygon_vertex = vertex_polygon_vertices[v];
+				const Vec3 delta = transformPosition(shape->GetControlPointAt(control_point)) - getPosition(control_point);
+				Vec3 normal_delta(0, 0, 0);
+				if (shape_normals)
+				{
+					normal_delta = getDirection(getLayerElement(shape_normals, control_point, polygon_vertex))
+								   - getDirection(getLayerElement(normals, control_point, polygon_vertex));
+				}
+				if (delta.length() <= min_distance && normal_delta.length() <= BLEND_SHAPE_MIN_NORMAL_DELTA) continue;
+
+				target.vertices.push(v);
+				target.positions.push(delta);
+				if (shape_normals) target.normals.push(normal_delta);
+			}
+			// a channel which does not touch this part of a mesh split by materials
+			if (target.vertices.empty()) import_mesh.blend_shapes.pop();
+		}
+	}
+}
+
+
+void FBXImporter::buildGeometry()
+{
+	// anything but the default formats needs ATTRIBUTE_TYPES_FLAG in the model
+	const bool default_formats = position_format == PositionFormat::FLOAT && uv_format == UVFormat::FLOAT
+								 && normal_format == NormalFormat::PACKED_U8 && skin_format == SkinFormat::FLOAT;
+	if (!default_formats && !extended_formats)
+	{
+		logWarning("FBX") << "Quantized vertex formats need extended formats, writing the default ones";
+	}
+	vertex_position_format = extended_formats ? position_format : PositionFormat::FLOAT;
+	vertex_uv_format = extended_formats ? uv_format : UVFormat::FLOAT;
+	vertex_normal_format = extended_formats ? normal_format : NormalFormat::PACKED_U8;
+	vertex_skin_format = extended_formats ? skin_format : SkinFormat::FLOAT;
+	if (vertex_skin_format == SkinFormat::UNORM8 && bones.size() > 256)
+	{
+		logWarning("FBX") << "Skeleton has " << bones.size() << " bones, joint indices do not fit in 8 bits, using full skin format";
+		vertex_skin_format = SkinFormat::FLOAT;
+	}
+
+	vertex_tangents = false;
+	vertex_uvs = false;
+	vertex_skin = false;
+	bool has_blend_shapes = false;
+	for (const ImportMesh& mesh : meshes)
+	{
+		if (!mesh.import) continue;
+		vertex_tangents = vertex_tangents || mesh.fbx->GetElementTangentCount() > 0;
+		vertex_uvs = vertex_uvs || mesh.fbx->GetElementUVCount() > 0;
+		vertex_skin = vertex_skin || isSkinned(mesh.fbx);
+		has_blend_shapes = has_blend_shapes || mesh.fbx->GetDeformerCount(FbxDeformer::EDeformerType::eBlendShape) > 0;
+	}
+	// BLEND_SHAPES_FLAG is not read by the engine yet
+	if (has_blend_shapes && import_blend_shapes && !extended_formats)
+	{
+		logWarning("FBX") << "Blend shapes need extended formats, they are not imported";
+	}
+
+	quantization_error = QuantizationError();
+	u32 corner_count = 0;
+	u32 vertex_count = 0;
+	for (ImportMesh& mesh : meshes)
+	{
+		if (!mesh.import) continue;
+
+		buildGeometry(mesh);
+		const u32 vertex_size = (u32)getVertexSize();
+		corner_count += mesh.indices.size();
+		vertex_count += u32(mesh.vertex_data.getPos() / vertex_size);
+	}
+	logInfo("FBX") << "Welded " << corner_count << " polygon corners into " << vertex_count << " vertices";
+
+	const QuantizationError& error = quantization_error;
+	logInfo("FBX") << "Max quantization error - position: " << error.position << ", uv: " << error.uv << ", normal: " << error.normal
+				   << " deg, tangent: " << error.tangent << " deg, weight: " << error.weight;
+}
+
+
+void FBXImporter::optimizeMeshes()
+{
+	struct Result
+	{
+		float acmr_before;
+		float acmr_after;
+	};
+
+	static const u32 ACMR_CACHE_SIZE = 16;
+	static const float OVERDRAW_THRESHOLD = 1.05f;
+
+	Array<ImportMesh*> to_optimize(allocator);
+	for (ImportMesh& mesh : meshes)
+	{
+		if (mesh.import && !mesh.indices.empty()) to_optimize.push(&mesh);
+	}
+	Array<Result> results(allocator);
+	results.resize(to_optimize.size());
+
+	parallelFor(to_optimize.size(), [&](i32 idx) {
+		ImportMesh& mesh = *to_optimize[idx];
+		const u32 stride = (u32)getVertexSize();
+		const u32 vertex_count = u32(mesh.vertex_data.getPos() / stride);
+		Span<u32> indices(mesh.indices.begin(), mesh.indices.end());
+		results[idx].acmr_before = MeshOptimizer::computeACMR(indices, vertex_count, ACMR_CACHE_SIZE, allocator);
+
+		MeshOptimizer::optimizeVertexCache(indices, vertex_count, allocator);
+		if (vertex_position_format == PositionFormat::FLOAT)
+		{
+			MeshOptimizer::optimizeOverdraw(indices, mesh.vertex_data.getData(), stride, vertex_count, OVERDRAW_THRESHOLD, allocator);
+		}
+		else
+		{
+			Array<Vec3> positions(allocator);
+			decodePositions(mesh, positions);
+			MeshOptimizer::optimizeOverdraw(indices, (const u8*)positions.begin(), sizeof(Vec3), vertex_count, OVERDRAW_THRESHOLD, allocator);
+		}
+		Array<u32> old_indices(allocator);
+		if (!mesh.blend_shapes.empty())
+		{
+			old_indices.resize(mesh.indices.size());
+			memcpy(old_indices.begin(), mesh.indices.begin(), mesh.indices.size() * sizeof(u32));
+		}
+		const u32 used = MeshOptimizer::optimizeVertexFetch(indices, mesh.vertex_data.getMutableData(), stride, vertex_count, allocator);
+		ASSERT(used == vertex_count);
+		(void)used;
+		if (!mesh.blend_shapes.empty())
+		{
+			// vertices were only reordered, so comparing the index buffers gives where each one went
+			Array<u32> remap(allocator);
+			remap.resize(vertex_count);
+			for (int i = 0; i < old_indices.size(); ++i) remap[old_indices[i]] = mesh.indices[i];
+			for (BlendShape& target : mesh.blend_shapes)
+			{
+				for (u32& v : target.vertices) v = remap[v];
+			}
+		}
+
+		results[idx].acmr_after = MeshOptimizer::computeACMR(indices, vertex_count, ACMR_CACHE_SIZE, allocator);
+	});
+
+	for (int i = 0; i < to_optimize.size(); ++i)
+	{
+		logInfo("FBX") << getImportMeshName(*to_optimize[i]) << ": ACMR " << results[i].acmr_before << " -> "
+					   << results[i].acmr_after;
+	}
+}
+
+
+void FBXImporter::decodePositions(const ImportMesh& mesh, Array<Vec3>& positions) const
+{
+	const u32 stride = (u32)getVertexSize();
+	const u32 vertex_count = u32(mesh.vertex_data.getPos() / stride);
+	const u8* data = mesh.vertex_data.getData();
+	positions.resize(vertex_count);
+	for (u32 i = 0; i < vertex_count; ++i)
+	{
+		if (vertex_position_format == PositionFormat::FLOAT)
+		{
+			memcpy(&positions[i], data + i * stride, sizeof(Vec3));
+			continue;
+		}
+
+		u16 encoded[3];
+		memcpy(encoded, data + i * stride, sizeof(encoded));
+		const Vec3& offset = mesh.position_offset;
+		const Vec3& scale = mesh.position_scale;
+		positions[i] = {offset.x + encoded[0] / 65535.0f * scale.x,
+			offset.y + encoded[1] / 65535.0f * scale.y,
+			offset.z + encoded[2] / 65535.0f * scale.z};
+	}
+}
+
+
+// joint with the largest weight for every vertex, 0 if the model is not skinned
+void FBXImporter::getDominantJoints(const ImportMesh& mesh, Array<u32>& joints) const
+{
+	const u32 stride = (u32)getVertexSize();
+	const u32 vertex_count = u32(mesh.vertex_data.getPos() / stride);
+	joints.resize(vertex_count);
+	const int joints_offset = getAttributeOffset(SEMANTIC_INDICES);
+	const int weights_offset = getAttributeOffset(SEMANTIC_WEIGHTS);
+	if (joints_offset < 0 || weights_offset < 0)
+	{
+		memset(joints.begin(), 0, vertex_count * sizeof(joints[0]));
+		return;
+	}
+
+	const u8* data = mesh.vertex_data.getData();
+	for (u32 i = 0; i < vertex_count; ++i)
+	{
+		const u8* vertex = data + i * stride;
+		int largest = 0;
+		if (vertex_skin_format == SkinFormat::UNORM8)
+		{
+			const u8* weights = vertex + weights_offset;
+			for (int k = 1; k < 4; ++k)
+			{
+				if (weights[k] > weights[largest]) largest = k;
+			}
+			joints[i] = vertex[joints_offset + largest];
+		}
+		else
+		{
+			float weights[4];
+			i16 indices[4];
+			memcpy(weights, vertex + weights_offset, sizeof(weights));
+			memcpy(indices, vertex + joints_offset, sizeof(indices));
+			for (int k = 1; k < 4; ++k)
+			{
+				if (weights[k] > weights[largest]) largest = k;
+			}
+			joints[i] = (u32)indices[largest];
+		}
+	}
+}
+
+
+void FBXImporter::generateLODs()
+{
+	static const int LOD_COUNT = lengthOf(lod_ratios);
+
+	for (const ImportMesh& mesh : meshes)
+	{
+		if (mesh.import && mesh.lod > 0)
+		{
+			logInfo("FBX") << "Source has LOD meshes, automatic LODs are not generated";
+			return;
+		}
+	}
+	if (lods_distances[0] < 0)
+	{
+		logWarning("FBX") << "LOD0 distance is infinite, generated LODs will never be visible";
+	}
+
+	Array<i32> sources(allocator);
+	for (int i = 0; i < meshes.size(); ++i)
+	{
+		if (meshes[i].import && !meshes[i].indices.empty()) sources.push(i);
+	}
+
+	Array<ImportMesh> lods(allocator);
+	Array<float> errors(allocator);
+	for (int i = 0; i < sources.size() * LOD_COUNT; ++i) lods.emplace(allocator);
+	errors.resize(lods.size());
+
+	parallelFor(sources.size(), [&](i32 idx) {
+		const ImportMesh& src = meshes[sources[idx]];
+		Array<Vec3> positions(allocator);
+		Array<u32> joints(allocator);
+		decodePositions(src, positions);
+		// collapsing across dominant joints would drag vertices between bones
+		if (isSkinned(src.fbx)) getDominantJoints(src, joints);
+
+		const u32 stride = (u32)getVertexSize();
+		const u32 vertex_count = positions.size();
+		const Array<u32>* prev_indices = &src.indices;
+		for (int lod_idx = 0; lod_idx < LOD_COUNT; ++lod_idx)
+		{
+			ImportMesh& lod = lods[idx * LOD_COUNT + lod_idx];
+			lod.fbx = src.fbx;
+			lod.fbx_mat = src.fbx_mat;
+			lod.material_index = src.material_index;
+			lod.lod = lod_idx + 1;
+			lod.generated_lod = true;
+			lod.aabb = src.aabb;
+			lod.radius_squared = src.radius_squared;
+			lod.position_offset = src.position_offset;
+			lod.position_scale = src.position_scale;
+			lod.uv_offset = src.uv_offset;
+			lod.uv_scale = src.uv_scale;
+
+			// LODs are chained, each one simplifies the previous one
+			const u32 target = u32(src.indices.size() / 3 * lod_ratios[lod_idx]) * 3;
+			lod.indices.resize(prev_indices->size());
+			const u32 index_count = MeshOptimizer::simplify(Span<u32>(lod.indices.begin(), lod.indices.end()),
+				Span<const u32>(prev_indices->begin(), prev_indices->end()),
+				Span<const Vec3>(positions.begin(), positions.end()),
+				joints.empty() ? nullptr : joints.begin(),
+				target,
+				lod_errors[lod_idx],
+				&errors[idx * LOD_COUNT + lod_idx],
+				allocator);
+			lod.indices.resize(index_count);
+			prev_indices = &lod.indices;
+		}
+
+		// every LOD gets only the vertices it references
+		Array<u8> vertices(allocator);
+		vertices.resize((u32)src.vertex_data.getPos());
+		for (int lod_idx = 0; lod_idx < LOD_COUNT; ++lod_idx)
+		{
+			ImportMesh& lod = lods[idx * LOD_COUNT + lod_idx];
+			memcpy(vertices.begin(), src.vertex_data.getData(), vertices.size());
+			Span<u32> indices(lod.indices.begin(), lod.indices.end());
+			const u32 used = MeshOptimizer::optimizeVertexFetch(indices, vertices.begin(), stride, vertex_count, allocator);
+			lod.vertex_data.write(vertices.begin(), used * stride);
+		}
+	});
+
+	for (int i = 0; i < sources.size(); ++i)
+	{
+		const ImportMesh& src = meshes[sources[i]];
+		for (int lod_idx = 0; lod_idx < LOD_COUNT; ++lod_idx)
+		{
+			const ImportMesh& lod = lods[i * LOD_COUNT + lod_idx];
+			logInfo("FBX") << getImportMeshName(src) << " LOD" << lod_idx + 1 << ": " << lod.indices.size() / 3 << " of "
+						   << src.indices.size() / 3 << " triangles, error " << errors[i * LOD_COUNT + lod_idx];
+		}
+	}
+	for (ImportMesh& lod : lods) meshes.emplace(static_cast<ImportMesh&&>(lod));
+}
+
+
+bool FBXImporter::areIndices16Bit() const
+{
+	for (const ImportMesh& mesh : meshes)
+	{
+		if (!mesh.import) continue;
+
+		const u32 vertex_count = u32(mesh.vertex_data.getPos() / getVertexSize());
+		if (vertex_count > (1 << 16)) return false;
+	}
+	return true;
+}
+
+
+void FBXImporter::writeGeometry()
+{
+	AABB aabb = {{FLT_MAX, FLT_MAX, FLT_MAX}, {-FLT_MAX, -FLT_MAX, -FLT_MAX}};
+	float radius_squared = 0;
+	i32 indices_count = 0;
+
+	for (const ImportMesh& mesh : meshes)
+	{
+		if (mesh.import) indices_count += mesh.indices.size();
+	}
+	write(indices_count);
+
+	const bool indices_16bit = areIndices16Bit();
+	for (const ImportMesh& mesh : meshes)
+	{
+		if (!mesh.import) continue;
+
+		for (u32 index : mesh.indices)
+		{
+			if (indices_16bit)
+			{
+				write((u16)index);
+			}
+			else
+			{
+				write(index);
+			}
+		}
+	}
+
+	u64 vertices_size = 0;
+	for (const ImportMesh& mesh : meshes)
+	{
+		if (mesh.import) vertices_size += mesh.vertex_data.getPos();
+	}
+	write(vertices_size);
+	for (const ImportMesh& mesh : meshes)
+	{
+		if (!mesh.import) continue;
+
+		write(mesh.vertex_data.getData(), mesh.vertex_data.getPos());
+		aabb.min.x = minimum(aabb.min.x, mesh.aabb.min.x);
+		aabb.min.y = minimum(aabb.min.y, mesh.aabb.min.y);
+		aabb.min.z = minimum(aabb.min.z, mesh.aabb.min.z);
+		aabb.max.x = maximum(aabb.max.x, mesh.aabb.max.x);
+		aabb.max.y = maximum(aabb.max.y, mesh.aabb.max.y);
+		aabb.max.z = maximum(aabb.max.z, mesh.aabb.max.z);
+		radius_squared = maximum(radius_squared, mesh.radius_squared);
+	}
+	write(sqrtf(radius_squared) * bounding_shape_scale);
+	aabb.min *= bounding_shape_scale;
+	aabb.max *= bounding_shape_scale;
+	write(aabb);
+}
+
+
+void FBXImporter::writeMeshes()
+{
+	i32 mesh_count = 0;
+	for (ImportMesh& mesh : meshes) if (mesh.import) ++mesh_count;
+	write(mesh_count);
+
+	i32 attr_offset = 0;
+	i32 indices_offset = 0;
+	for (ImportMesh& import_mesh : meshes)
+	{
+		if (!import_mesh.import) continue;
+
+		// meshes without a material use the engine's default one
+		FbxSurfaceMaterial* material = import_mesh.fbx_mat;
+		const char* mat = material ? material->GetName() : "default";
+		i32 mat_len = (i32)strlen(mat);
+		write(mat_len);
+		write(mat, strlen(mat));
+
+		write(attr_offset);
+		i32 attr_size = (i32)import_mesh.vertex_data.getPos();
+		attr_offset += attr_size;
+		write(attr_size);
+
+		write(indices_offset);
+		i32 mesh_tri_count = import_mesh.indices.size() / 3;
+		indices_offset += mesh_tri_count * 3;
+		write(mesh_tri_count);
+
+		const char* name = getImportMeshName(import_mesh);
+		i32 name_len = (i32)strlen(name);
+		write(name_len);
+		write(name, strlen(name));
+
+		if (hasAttributeTypes())
+		{
+			write(import_mesh.position_offset);
+			write(import_mesh.position_scale);
+			write(import_mesh.uv_offset);
+			write(import_mesh.uv_scale);
+		}
+	}
+}
+
+
+void FBXImporter::writeSkeleton()
+{
+	if(ignore_skeleton)
+	{
+		write((int)0);
+		return;
+	}
+
+	write(bones.size());
+
+	for (FbxNode* node : bones)
+	{
+		const char* name = node->GetName();
+		int len = (int)strlen(name);
+		write(len);
+		writeString(name);
+
+		FbxNode* parent = node->GetParent();
+		if (!parent)
+		{
+			write((int)0);
+		}
+		else
+		{
+			const char* parent_name = parent->GetName();
+			len = (int)strlen(parent_name);
+			write(len);
+			writeString(parent_name);
+		}
+
+		FbxAMatrix tr = getBindPoseMatrix(node);
+
+		Quat q = fixOrientation(toLumix(tr.GetQ()));
+		Vec3 t = fixOrientation(toLumixVec3(tr.GetT()));
+		write(t * mesh_scale);
+		write(q);
+	}
+}
+
+
+void FBXImporter::writeLODs()
+{
+	i32 lod_count = 1;
+	i32 last_mesh_idx = -1;
+	i32 lods[8] = {};
+	for (auto& mesh : meshes)
+	{
+		if (!mesh.import) continue;
+
+		++last_mesh_idx;
+		if (mesh.lod >= lengthOf(lods_distances)) continue;
+		lod_count = mesh.lod + 1;
+		lods[mesh.lod] = last_mesh_idx;
+	}
+
+	for (int i = 1; i < Lumix::lengthOf(lods); ++i)
+	{
+		if (lods[i] < lods[i - 1]) lods[i] = lods[i - 1];
+	}
+
+	write((const char*)&lod_count, sizeof(lod_count));
+
+	for (int i = 0; i < lod_count; ++i)
+	{
+		i32 to_mesh = lods[i];
+		write((const char*)&to_mesh, sizeof(to_mesh));
+		float factor = lods_distances[i] < 0 ? FLT_MAX : lods_distances[i] * lods_distances[i];
+		write((const char*)&factor, sizeof(factor));
+	}
+
+}
+
+
+// per mesh a list of targets, each with its vertex indices, position deltas as 16-bit snorm in the target's range
+// and optionally normal deltas as 8-bit snorm, indices are 16-bit if the mesh has at most 65536 vertices
+void FBXImporter::writeBlendShapes()
+{
+	bool has_blend_shapes = false;
+	for (const ImportMesh& mesh : meshes)
+	{
+		if (mesh.import && !mesh.blend_shapes.empty()) has_blend_shapes = true;
+	}
+	if (!has_blend_shapes) return;
+
+	u32 delta_count = 0;
+	u32 dense_count = 0;
+	float max_error = 0;
+	for (const ImportMesh& mesh : meshes)
+	{
+		if (!mesh.import) continue;
+
+		const u32 vertex_count = u32(mesh.vertex_data.getPos() / getVertexSize());
+		const bool indices_16bit = vertex_count <= 0x10000;
+		write((u32)mesh.blend_shapes.size());
+		for (const BlendShape& target : mesh.blend_shapes)
+		{
+			write((i32)stringLength(target.name));
+			writeString(target.name);
+			write((u32)target.vertices.size());
+			write((u8)!target.normals.empty());
+			for (u32 v : target.vertices)
+			{
+				if (indices_16bit) write(u16(v));
+				else write(v);
+			}
+
+			Vec3 range(0, 0, 0);
+			for (const Vec3& delta : target.positions)
+			{
+				range = {maximum(range.x, fabsf(delta.x)), maximum(range.y, fabsf(delta.y)), maximum(range.z, fabsf(delta.z))};
+			}
+			write(range);
+			for (const Vec3& delta : target.positions)
+			{
+				const i16 encoded[3] = {
+					toSnorm<i16>(delta.x, range.x, 32767), toSnorm<i16>(delta.y, range.y, 32767), toSnorm<i16>(delta.z, range.z, 32767)};
+				write(encoded);
+				const Vec3 decoded(encoded[0] / 32767.0f * range.x, encoded[1] / 32767.0f * range.y, encoded[2] / 32767.0f * range.z);
+				max_error = maximum(max_error, (decoded - delta).length());
+			}
+			// difference of unit vectors is in [-2, 2]
+			for (const Vec3& delta : target.normals)
+			{
+				const i8 encoded[3] = {toSnorm<i8>(delta.x, 2, 127), toSnorm<i8>(delta.y, 2, 127), toSnorm<i8>(delta.z, 2, 127)};
+				write(encoded);
+			}
+			delta_count += target.vertices.size();
+			dense_count += vertex_count;
+		}
+	}
+	logInfo("FBX") << "Blend shapes: " << delta_count << " of " << dense_count << " vertex deltas stored, max position error "
+				   << max_error;
+}
+
+
+int FBXImporter::getAttributeCount() const
+{
+	VertexAttribute attributes[MAX_ATTRIBUTES];
+	return getAttributes(Span(attributes));
+}
+
+
+void FBXImporter::writeModelHeader()
+{
+	Model::FileHeader header;
+	header.magic = 0x5f4c4d4f; // == '_LMO';
+	header.version = (u32)Model::FileVersion::LATEST;
+	write(header);
+	const bool attribute_types = hasAttributeTypes();
+	u32 flags = areIndices16Bit() ? (u32)Model::Flags::INDICES_16BIT : 0;
+	if (attribute_types) flags |= ATTRIBUTE_TYPES_FLAG;
+	for (const ImportMesh& import_mesh : meshes)
+	{
+		if (import_mesh.import && !import_mesh.blend_shapes.empty()) flags |= BLEND_SHAPES_FLAG;
+	}
+	write(flags);
+
+	VertexAttribute attributes[MAX_ATTRIBUTES];
+	i32 attribute_count = getAttributes(Span(attributes));
+	write(attribute_count);
+	for (int i = 0; i < attribute_count; ++i)
+	{
+		const VertexAttribute& attr = attributes[i];
+		write(attr.semantic);
+		if (attribute_types)
+		{
+			write(attr.type);
+			write(attr.components);
+			write((u8)attr.normalized);
+		}
+	}
+}
+
+
+void FBXImporter::makeTextureDirRelative()
+{
+	texture_output_dir = texture_dir.empty() ? output_dir : texture_dir;
+	if (texture_dir.empty() || base_path.empty()) return;
+
+	char tmp[MAX_PATH_LENGTH];
+	Path::normalize(texture_dir, Span(tmp));
+	if (startsWith(tmp, base_path))
+	{
+		texture_dir = "/";
+		texture_dir << tmp + stringLength(base_path);
+	}
+	else if (tmp[0] == '/' && !OS::dirExists(tmp))
+	{
+		// made relative by a previous import
+		texture_output_dir = StaticString<MAX_PATH_LENGTH>(base_path, tmp + 1);
+	}
+}
+
+
+bool FBXImporter::openOutput(const char* filename)
+{
+	StaticString<MAX_PATH_LENGTH> path(output_dir, filename);
+	if (!out_file.open(path))
+	{
+		logError("FBX") << "Failed to create " << path;
+		return false;
+	}
+	out_buffer_pos = 0;
+	out_error = false;
+	out_size = 0;
+	output_files.emplace(filename);
+	output_sizes.push(0);
+	return true;
+}
+
+
+void FBXImporter::flushOutput()
+{
+	if (out_buffer_pos == 0) return;
+	if (!out_file.write(out_buffer, out_buffer_pos)) out_error = true;
+	out_size += out_buffer_pos;
+	out_buffer_pos = 0;
+}
+
+
+void FBXImporter::flushAndWrite(const void* ptr, size_t size)
+{
+	flushOutput();
+	if (size < OUTPUT_BUFFER_SIZE)
+	{
+		memcpy(out_buffer, ptr, size);
+		out_buffer_pos = (u32)size;
+		return;
+	}
+	if (!out_file.write(ptr, size)) out_error = true;
+	out_size += size;
+}
+
+
+bool FBXImporter::closeOutput()
+{
+	flushOutput();
+	out_file.close();
+	output_sizes.back() = out_size;
+	if (!out_error) return true;
+
+	logError("FBX") << "Failed to write " << output_files.back();
+	return false;
+}
+
+
+void FBXImporter::normalizeDirectories()
+{
+	if (!endsWith(output_dir.data, "/") && !endsWith(output_dir.data, "\\"))
+	{
+		output_dir << "/";
+	}
+	makeTextureDirRelative();
+	if (!endsWith(texture_dir.data, "/") && !endsWith(texture_dir.data, "\\") && !texture_dir.empty())
+	{
+		texture_dir << "/";
+	}
+	if (!endsWith(texture_output_dir.data, "/") && !endsWith(texture_output_dir.data, "\\"))
+	{
+		texture_output_dir << "/";
+	}
+	if (!endsWith(cache_dir.data, "/") && !endsWith(cache_dir.data, "\\") && !cache_dir.empty())
+	{
+		cache_dir << "/";
+	}
+}
+
+
+u64 FBXImporter::getCacheKey(Span<const char* const> filenames, bool selection) const
+{
+	CacheHasher hasher;
+	hasher.update(CACHE_VERSION);
+
+	Array<u8> buffer(allocator);
+	buffer.resize(64 * 1024);
+	for (u32 i = 0; i < filenames.length(); ++i)
+	{
+		OS::InputFile file;
+		if (!file.open(filenames[i])) return 0;
+		u64 size = file.size();
+		hasher.update(size);
+		while (size > 0)
+		{
+			const u64 chunk = minimum(size, (u64)buffer.size());
+			if (!file.read(buffer.begin(), chunk))
+			{
+				file.close();
+				return 0;
+			}
+			hasher.update(buffer.begin(), chunk);
+			size -= chunk;
+		}
+		file.close();
+	}
+
+	hasher.updateString(output_mesh_filename);
+	hasher.updateString(texture_dir);
+	hasher.update(mesh_scale);
+	hasher.update(bounding_shape_scale);
+	hasher.update(animation_max_error);
+	hasher.updateString(root_motion_bone);
+	hasher.updateString(additive_reference);
+	hasher.update(animation_format);
+	hasher.update(orientation);
+	hasher.update(center_mesh);
+	hasher.update(ignore_skeleton);
+	hasher.update(to_dds);
+	hasher.update(bc7_textures);
+	hasher.update(use_native_reader);
+	hasher.update(optimize_meshes);
+	hasher.update(extended_formats);
+	hasher.update(import_blend_shapes);
+	hasher.update(position_format);
+	hasher.update(uv_format);
+	hasher.update(normal_format);
+	hasher.update(skin_format);
+	hasher.update(lods_distances);
+	hasher.update(generate_lods);
+	hasher.update(lod_ratios);
+	hasher.update(lod_errors);
+	hasher.update(decompose_convex);
+	hasher.update(physics_all_meshes);
+	hasher.update(max_concavity);
+	hasher.update(max_convex_hulls);
+
+	// what the user picked in the loaded sources, without it the defaults are assumed
+	hasher.update(selection);
+	if (selection)
+	{
+		// writeModel reorders meshes and convert() appends generated LODs, so hashes of the source meshes
+		// are summed, which does not depend on their order
+		u64 meshes_hash = 0;
+		for (const ImportMesh& mesh : meshes)
+		{
+			if (mesh.generated_lod) continue;
+			CacheHasher mesh_hasher;
+			mesh_hasher.update(scenes.indexOf(mesh.fbx->GetScene()));
+			mesh_hasher.updateString(getImportMeshName(mesh));
+			mesh_hasher.update(mesh.material_index);
+			mesh_hasher.update(mesh.import);
+			mesh_hasher.update(mesh.import_physics);
+			mesh_hasher.update(mesh.lod);
+			meshes_hash += mesh_hasher.hash;
+		}
+		hasher.update(meshes_hash);
+		for (const ImportMaterial& material : materials)
+		{
+			hasher.update(material.import);
+			hasher.update(material.alpha_cutout);
+		}
+		for (const ImportAnimation& animation : animations)
+		{
+			hasher.update(animation.import);
+			hasher.updateString(animation.output_filename);
+			hasher.updateString(animation.root_motion_bone);
+			hasher.updateString(animation.additive_reference);
+			hasher.update(animation.additive_pose);
+		}
+	}
+	// 0 means uncached
+	return hasher.hash ? hasher.hash : 1;
+}
+
+
+bool FBXImporter::restoreFromCache(u64 key)
+{
+	StageScope stage(*this, "restore from cache");
+	const StaticString<MAX_PATH_LENGTH> entry_dir(cache_dir, key, "/");
+	OS::InputFile index;
+	if (!index.open(StaticString<MAX_PATH_LENGTH>(entry_dir, CACHE_INDEX_FILENAME))) return false;
+
+	Array<char> content(allocator);
+	content.resize((int)index.size() + 1);
+	const bool read = index.read(content.begin(), index.size());
+	index.close();
+	if (!read) return false;
+	content[content.size() - 1] = '\0';
+
+	OS::makePath(output_dir);
+	output_files.clear();
+	output_sizes.clear();
+	char* line = content.begin();
+	while (*line)
+	{
+		char* end = line;
+		while (*end && *end != '\n') ++end;
+		const bool last = *end == '\0';
+		*end = '\0';
+		if (*line)
+		{
+			const StaticString<MAX_PATH_LENGTH> from(entry_dir, line);
+			const StaticString<MAX_PATH_LENGTH> to(output_dir, line);
+			// outputs such as textures can be in subdirectories of output_dir
+			OS::makePath(PathInfo(to).m_dir);
+			if (!OS::copyFile(from, to))
+			{
+				logError("FBX") << "Failed to copy " << from << " to " << to;
+				return false;
+			}
+			output_files.emplace(line);
+		}
+		if (last) break;
+		line = end + 1;
+	}
+	logInfo("FBX") << "Restored " << output_files.size() << " files from " << entry_dir;
+	gatherOutputStats();
+	return true;
+}
+
+
+void FBXImporter::storeToCache(u64 key)
+{
+	StageScope stage(*this, "store to cache");
+	// entries are never evicted, a missing or truncated output would be restored by every later import
+	if (output_sizes.size() != output_files.size()) return;
+	for (int i = 0; i < output_files.size(); ++i)
+	{
+		const StaticString<MAX_PATH_LENGTH> path(output_dir, output_files[i]);
+		OS::InputFile file;
+		const bool opened = file.open(path);
+		const u64 size = opened ? file.size() : 0;
+		if (opened) file.close();
+		if (!opened || size != output_sizes[i])
+		{
+			logWarning("FBX") << path << " is not completely written, the import is not cached";
+			return;
+		}
+	}
+
+	const StaticString<MAX_PATH_LENGTH> entry_dir(cache_dir, key, "/");
+	if (!OS::makePath(entry_dir))
+	{
+		logWarning("FBX") << "Failed to create cache directory " << entry_dir;
+		return;
+	}
+
+	for (const auto& filename : output_files)
+	{
+		const StaticString<MAX_PATH_LENGTH> from(output_dir, filename);
+		const StaticString<MAX_PATH_LENGTH> to(entry_dir, filename);
+		OS::makePath(PathInfo(to).m_dir);
+		if (!OS::copyFile(from, to))
+		{
+			logWarning("FBX") << "Failed to copy " << from << " to " << to;
+			return;
+		}
+	}
+
+	// the index is written last, an entry without it is incomplete and never restored
+	OS::OutputFile index;
+	if (!index.open(StaticString<MAX_PATH_LENGTH>(entry_dir, CACHE_INDEX_FILENAME)))
+	{
+		logWarning("FBX") << "Failed to create cache index in " << entry_dir;
+		return;
+	}
+	for (const auto& filename : output_files)
+	{
+		index.write(filename.data, stringLength(filename.data));
+		index.write("\n", 1);
+	}
+	index.close();
+}
+
+
+bool FBXImporter::import()
+{
+	normalizeDirectories();
+	if (cache_dir.empty()) return loadPreviewed() && convert();
+
+	// previewed sources are hashed like the loaded ones, they are loaded only on a cache miss
+	Array<const char*> filenames(allocator);
+	for (const auto& path : source_paths) filenames.push(path.data);
+	for (const ScenePreview& preview : previews) filenames.push(preview.path.data);
+	const u64 key = getCacheKey(Span<const char* const>(filenames.begin(), filenames.end()), true);
+	if (key && restoreFromCache(key)) return true;
+	if (!loadPreviewed()) return false;
+	if (!convert()) return false;
+	if (key) storeToCache(key);
+	return true;
+}
+
+
+bool FBXImporter::importCached(Span<const char* const> filenames)
+{
+	normalizeDirectories();
+	if (output_mesh_filename.empty() && filenames.length() > 0)
+	{
+		Path::getBasename(Span(output_mesh_filename.data, lengthOf(output_mesh_filename.data)), filenames[0]);
+	}
+	const u64 key = cache_dir.empty() ? 0 : getCacheKey(filenames, false);
+	if (key && restoreFromCache(key)) return true;
+
+	const StaticString<MAX_PATH_LENGTH> mesh_filename = output_mesh_filename;
+	if (!addSources(filenames)) return false;
+	output_mesh_filename = mesh_filename;
+	if (!convert()) return false;
+	if (key) storeToCache(key);
+	return true;
+}
+
+
+bool FBXImporter::convert()
+{
+	output_files.clear();
+	output_sizes.clear();
+
+	// generated LODs are rebuilt from scratch on every import
+	for (int i = meshes.size() - 1; i >= 0; --i)
+	{
+		if (meshes[i].generated_lod) meshes.erase(i);
+	}
+
+	{
+		StageScope stage(*this, "build geometry");
+		buildGeometry();
+	}
+	if (generate_lods)
+	{
+		StageScope stage(*this, "generate lods");
+		generateLODs();
+	}
+	if (optimize_meshes)
+	{
+		StageScope stage(*this, "optimize meshes");
+		optimizeMeshes();
+	}
+	// every output is attempted, a failed one does not hide errors of the rest
+	bool success = true;
+	{
+		StageScope stage(*this, "write model");
+		success = writeModel() && success;
+	}
+	{
+		StageScope stage(*this, "cook physics");
+		success = writePhysics() && success;
+	}
+	{
+		StageScope stage(*this, "write animations");
+		success = writeAnimations() && success;
+	}
+	{
+		StageScope stage(*this, "write materials");
+		success = writeMaterials() && success;
+	}
+	if (to_dds)
+	{
+		StageScope stage(*this, "convert textures");
+		success = writeTextures() && success;
+	}
+	gatherOutputStats();
+	return success;
+}
+
+
+bool FBXImporter::writeModel()
+{
+	bool import_any_mesh = false;
+	for (const ImportMesh& m : meshes) if (m.import) import_any_mesh = true;
+	if (!import_any_mesh) return true;
+
+	// meshes own arrays and streams, so they are moved, not swapped bytewise by qsort
+	// stable, meshes of one LOD stay in the source order
+	int min_lod = meshes[0].lod;
+	int max_lod = meshes[0].lod;
+	for (const ImportMesh& m : meshes)
+	{
+		min_lod = minimum(min_lod, m.lod);
+		max_lod = maximum(max_lod, m.lod);
+	}
+	Array<ImportMesh> sorted(allocator);
+	sorted.reserve(meshes.size());
+	for (int lod = min_lod; lod <= max_lod; ++lod)
+	{
+		for (ImportMesh& m : meshes)
+		{
+			if (m.lod == lod) sorted.emplace(static_cast<ImportMesh&&>(m));
+		}
+	}
+	meshes = static_cast<Array<ImportMesh>&&>(sorted);
+	StaticString<MAX_PATH_LENGTH> filename(output_mesh_filename, ".msh");
+	OS::makePath(output_dir);
+	if (!openOutput(filename)) return false;
+
+	writeModelHeader();
+	writeMeshes();
+	writeGeometry();
+	writeSkeleton();
+	writeLODs();
+	writeBlendShapes();
+	return closeOutput();
+}
+
+
+// the .phy sidecar, per mesh: convex hulls and a triangle mesh with its BVH, all in model space
+bool FBXImporter::writePhysics()
+{
+	static const u32 MAX_HULL_VERTICES = 255;
+	static const u32 MAX_LEAF_TRIANGLES = 4;
+
+	struct Cooked
+	{
+		explicit Cooked(IAllocator& allocator)
+			: hulls(allocator)
+			, vertices(allocator)
+			, indices(allocator)
+			, nodes(allocator)
+		{
+		}
+
+		const ImportMesh* mesh = nullptr;
+		Array<PhysicsCooker::ConvexHull> hulls;
+		Array<Vec3> vertices;
+		Array<u32> indices;
+		Array<PhysicsCooker::BVHNode> nodes;
+	};
+
+	Array<Cooked> cooked(allocator);
+	for (const ImportMesh& mesh : meshes)
+	{
+		if (!mesh.import || !(mesh.import_physics || physics_all_meshes) || mesh.lod != 0 || mesh.generated_lod) continue;
+		cooked.emplace(allocator).mesh = &mesh;
+	}
+	if (cooked.empty()) return true;
+
+	parallelFor(cooked.size(), [&](i32 idx) {
+		Cooked& c = cooked[idx];
+		const ImportMesh& mesh = *c.mesh;
+
+		// render vertices are split by normals and uvs, collision wants them shared
+		Array<Vec3> positions(allocator);
+		Array<u32> remap(allocator);
+		decodePositions(mesh, positions);
+		PhysicsCooker::weldPositions(Span<const Vec3>(positions.begin(), positions.end()), c.vertices, remap, allocator);
+		c.indices.resize(mesh.indices.size());
+		for (int i = 0; i < mesh.indices.size(); ++i) c.indices[i] = remap[mesh.indices[i]];
+
+		const Span<const Vec3> vertices(c.vertices.begin(), c.vertices.end());
+		if (decompose_convex)
+		{
+			const Span<const u32> indices(c.indices.begin(), c.indices.end());
+			PhysicsCooker::decompose(vertices, indices, max_concavity, max_convex_hulls, MAX_HULL_VERTICES, c.hulls, allocator);
+		}
+		else
+		{
+			PhysicsCooker::ConvexHull hull(allocator);
+			if (PhysicsCooker::computeConvexHull(vertices, MAX_HULL_VERTICES, hull, allocator))
+			{
+				c.hulls.emplace(static_cast<PhysicsCooker::ConvexHull&&>(hull));
+			}
+		}
+
+		PhysicsCooker::buildBVH(vertices, Span<u32>(c.indices.begin(), c.indices.end()), MAX_LEAF_TRIANGLES, c.nodes, allocator);
+	});
+
+	StaticString<MAX_PATH_LENGTH> filename(output_mesh_filename, ".phy");
+	if (!openOutput(filename)) return false;
+
+	write(PHYSICS_MAGIC);
+	write(PHYSICS_VERSION);
+	write((u32)cooked.size());
+	for (const Cooked& c : cooked)
+	{
+		const char* name = getImportMeshName(*c.mesh);
+		write((u32)strlen(name));
+		writeString(name);
+
+		if (c.hulls.empty()) logWarning("FBX") << name << " is flat, it has no convex hull";
+		write((u32)c.hulls.size());
+		for (const PhysicsCooker::ConvexHull& hull : c.hulls)
+		{
+			write((u32)hull.vertices.size());
+			write(hull.vertices.begin(), hull.vertices.size() * sizeof(hull.vertices[0]));
+			write((u32)hull.indices.size());
+			write(hull.indices.begin(), hull.indices.size() * sizeof(hull.indices[0]));
+		}
+
+		write((u32)c.vertices.size());
+		write(c.vertices.begin(), c.vertices.size() * sizeof(c.vertices[0]));
+		write((u32)c.indices.size());
+		write(c.indices.begin(), c.indices.size() * sizeof(c.indices[0]));
+		write((u32)c.nodes.size());
+		write(c.nodes.begin(), c.nodes.size() * sizeof(c.nodes[0]));
+	}
+	return closeOutput();
+}
+
+
+void FBXImporter::clearSources()
+{
+	for (int i = 0; i < scenes.size(); ++i) destroyScene(scenes[i], scene_memory[i], source_paths[i]);
+	scenes.clear();
+	scene_memory.clear();
+	source_paths.clear();
+	previews.clear();
+	meshes.clear();
+	materials.clear();
+	animations.clear();
+	source_stats.clear();
+	bones.clear();
+	bone_indices.clear();
+	bone_clusters.clear();
+	skeletons.clear();
+	scene_bones.clear();
+}
+
+
+} // namespace Lumix
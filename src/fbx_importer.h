@@ -0,0 +1,471 @@
+#pragma once
+
+
+#include <fbxsdk.h>
+#include "engine/array.h"
+#include "engine/geometry.h"
+#include "engine/hash_map.h"
+#include "engine/math.h"
+#include "engine/os.h"
+#include "engine/stream.h"
+#include "engine/string.h"
+#include "engine/sync.h"
+
+
+namespace Lumix
+{
+
+
+struct FBXImporter
+{
+	struct ImportAnimation
+	{
+		FbxAnimStack* fbx = nullptr;
+		StaticString<MAX_PATH_LENGTH> output_filename;
+		// horizontal translation and yaw of this bone go to a root motion track, empty for none
+		StaticString<64> root_motion_bone;
+		// output filename of the animation this one is baked against as additive deltas, empty for none
+		StaticString<MAX_PATH_LENGTH> additive_reference;
+		// the reference is its first frame instead of the whole clip stretched to this one's length
+		bool additive_pose = false;
+		bool import = true;
+	};
+
+	struct ImportMaterial
+	{
+		FbxSurfaceMaterial* fbx = nullptr;
+		bool import = true;
+		bool alpha_cutout = false;
+	};
+
+	// one target of a blend shape channel, only vertices which it changes are stored
+	struct BlendShape
+	{
+		explicit BlendShape(IAllocator& allocator)
+			: vertices(allocator)
+			, positions(allocator)
+			, normals(allocator)
+		{
+		}
+
+		StaticString<64> name;
+		Array<u32> vertices;
+		// deltas, parallel to vertices, normals are empty if the target does not change them
+		Array<Vec3> positions;
+		Array<Vec3> normals;
+	};
+
+	struct ImportMesh
+	{
+		explicit ImportMesh(IAllocator& allocator)
+			: vertex_data(allocator)
+			, indices(allocator)
+			, blend_shapes(allocator)
+		{
+		}
+
+		FbxMesh* fbx = nullptr;
+		FbxSurfaceMaterial* fbx_mat = nullptr;
+		bool import = true;
+		bool import_physics = false;
+		int lod = 0;
+		bool generated_lod = false;
+		// only polygons with this material index belong to the mesh, -1 takes all of them
+		int material_index = -1;
+		// unique vertices and the index buffer referencing them, filled by buildGeometry
+		OutputMemoryStream vertex_data;
+		Array<u32> indices;
+		AABB aabb;
+		float radius_squared = 0;
+		// quantized attributes are decoded as offset + value * scale
+		Vec3 position_offset{0, 0, 0};
+		Vec3 position_scale{1, 1, 1};
+		Vec2 uv_offset{0, 0};
+		Vec2 uv_scale{1, 1};
+		// filled by buildGeometry, generated LODs have none
+		Array<BlendShape> blend_shapes;
+	};
+
+	struct TranslationKey
+	{
+		Vec3 pos;
+		float time;
+		u16 frame;
+	};
+
+	struct RotationKey
+	{
+		Quat rot;
+		float time;
+		u16 frame;
+	};
+
+	struct Skin
+	{
+		float weights[4] = {};
+		i16 joints[4] = {};
+		int count = 0;
+	};
+
+	struct StageStats
+	{
+		StaticString<64> name;
+		// seconds since the importer was created
+		float start;
+		float time;
+		u64 peak_memory;
+		// 0 is the importing thread, parallel load workers are 1 and up
+		u32 thread;
+		// only stages at depth 0 of thread 0 add up to the total
+		u32 depth;
+	};
+
+	struct FileStats
+	{
+		StaticString<MAX_PATH_LENGTH> path;
+		u32 polygons = 0;
+		u32 control_points = 0;
+		u32 clusters = 0;
+		u32 animation_frames = 0;
+		// file size of a source, written size of an output
+		u64 bytes = 0;
+		// FBX SDK memory of a source's scene
+		u64 sdk_memory = 0;
+		u64 sdk_peak_memory = 0;
+	};
+
+	// contents of a source read from its metadata, without geometry and animation curves
+	struct ScenePreview
+	{
+		struct Mesh
+		{
+			StaticString<64> name;
+			// the exact polygon count is only known once the compressed index array is inflated
+			u32 polygon_vertices = 0;
+			u32 control_points = 0;
+			u32 materials = 0;
+		};
+
+		struct AnimationStack
+		{
+			StaticString<64> name;
+			// in seconds
+			double start = 0;
+			double stop = 0;
+		};
+
+		explicit ScenePreview(IAllocator& allocator)
+			: meshes(allocator)
+			, materials(allocator)
+			, animations(allocator)
+		{
+		}
+
+		StaticString<MAX_PATH_LENGTH> path;
+		Array<Mesh> meshes;
+		Array<StaticString<64>> materials;
+		Array<AnimationStack> animations;
+		u32 bones = 0;
+	};
+
+	// bones of sources with the same names, hierarchy and bind pose are gathered only once
+	struct Skeleton
+	{
+		u64 hash;
+		// range in bones
+		int first_bone;
+		int bone_count;
+		// the source the bones come from
+		int scene;
+	};
+
+	struct SceneMemory
+	{
+		u32 slot;
+		// own manager of a scene in an arena, so everything it allocates is gone when it is destroyed
+		FbxManager* manager;
+	};
+
+	enum class PositionFormat
+	{
+		FLOAT,
+		UNORM16
+	};
+
+	enum class UVFormat
+	{
+		FLOAT,
+		HALF,
+		UNORM16
+	};
+
+	enum class NormalFormat
+	{
+		PACKED_U8,
+		OCTAHEDRAL
+	};
+
+	enum class SkinFormat
+	{
+		FLOAT,
+		UNORM8
+	};
+
+	enum class AttributeType : u8
+	{
+		FLOAT,
+		HALF,
+		U8,
+		I16,
+		U16
+	};
+
+	enum class AnimationFormat
+	{
+		FLOAT,
+		// 16-bit translations normalized to the track range, smallest three rotations
+		QUANTIZED_48,
+		QUANTIZED_32
+	};
+
+	struct VertexAttribute
+	{
+		i32 semantic;
+		AttributeType type;
+		u8 components;
+		bool normalized;
+	};
+
+	struct QuantizationError
+	{
+		float position = 0;
+		float uv = 0;
+		// in degrees
+		float normal = 0;
+		float tangent = 0;
+		float weight = 0;
+	};
+
+	enum class Orientation
+	{
+		Y_UP,
+		Z_UP,
+		Z_MINUS_UP,
+		X_MINUS_UP
+	};
+
+	explicit FBXImporter(IAllocator& allocator);
+	~FBXImporter();
+
+	// with preview_sources set, binary files are only previewed and fully loaded by import() on a cache miss or loadPreviewed()
+	bool addSource(const char* filename);
+	// loads all files concurrently, each worker thread uses its own FbxManager
+	// results are merged in the order of filenames
+	bool addSources(Span<const char* const> filenames);
+	void clearSources();
+	bool loadPreviewed();
+	bool import();
+	// with cache_dir set, restores the outputs of the same sources and options without loading the sources
+	bool importCached(Span<const char* const> filenames);
+	void benchmarkReaders();
+	void clearStats();
+	void updateMemoryStats();
+	// stages as complete events and files as instant events in Chrome trace event format
+	bool writeTrace(const char* path);
+
+	static const char* getImportMeshName(const ImportMesh& mesh);
+	static u64 getPeakMemory();
+
+private:
+	struct StageScope
+	{
+		StageScope(FBXImporter& importer, const char* name);
+		~StageScope();
+
+		FBXImporter& importer;
+		StaticString<64> name;
+		float start;
+		u32 depth;
+	};
+
+	static FbxManager* createManager();
+	FbxScene* loadSDK(FbxManager& manager, const char* filename);
+	FbxScene* loadNative(FbxManager& manager, const char* filename);
+	FbxScene* loadScene(FbxManager& manager, const char* filename);
+	void addScene(FbxScene* scene, const char* filename, const SceneMemory& memory);
+	SceneMemory createSceneMemory();
+	void destroyScene(FbxScene* scene, const SceneMemory& memory, const char* filename);
+	bool isBinaryFBX(const char* filename) const;
+	bool previewSource(const char* filename);
+	bool convert();
+	void normalizeDirectories();
+	u64 getCacheKey(Span<const char* const> filenames, bool selection) const;
+	bool restoreFromCache(u64 key);
+	void storeToCache(u64 key);
+	bool openOutput(const char* filename);
+	void pushStage(const char* name, float start, float time, u32 depth);
+	void gatherSourceStats(const char* filename, int first_mesh);
+	void gatherOutputStats();
+
+	int getBoneIndex(FbxNode* node) const;
+	FbxAMatrix getBindPoseMatrix(FbxNode* node) const;
+	void insertHierarchy(FbxNode* node, Array<FbxNode*>& scene_bones);
+	void gatherMaterials(FbxNode* node);
+	void gatherBones(FbxNode* node, Array<FbxNode*>& scene_bones);
+	void shareSkeleton(Array<FbxNode*>& scene_bones, const char* filename);
+	void gatherBoneClusters(int first_mesh);
+	void gatherAnimations(FbxScene* scene);
+	void gatherMeshes(FbxScene* scene);
+
+	bool isSkinned(FbxMesh* mesh) const;
+	// one layout for all meshes, the union of what the imported meshes have
+	int getAttributes(Span<VertexAttribute> attributes) const;
+	int getAttributeOffset(i32 semantic) const;
+	bool hasAttributeTypes() const;
+	int getVertexSize() const;
+	int getAttributeCount() const;
+	void fillSkinInfo(Array<Skin>& skinning, const FbxMesh* mesh) const;
+	Vec3 fixOrientation(const Vec3& v) const;
+	Quat fixOrientation(const Quat& v) const;
+	void makeTextureDirRelative();
+
+	// small writes are gathered in out_buffer, the file only gets whole buffers and large blocks
+	template <typename T> void write(const T& obj) { write(&obj, sizeof(obj)); }
+	void write(const void* ptr, size_t size)
+	{
+		if (out_buffer_pos + size <= OUTPUT_BUFFER_SIZE)
+		{
+			memcpy(out_buffer + out_buffer_pos, ptr, size);
+			out_buffer_pos += (u32)size;
+			return;
+		}
+		flushAndWrite(ptr, size);
+	}
+	void writeString(const char* str) { write(str, strlen(str)); }
+	void flushAndWrite(const void* ptr, size_t size);
+	void flushOutput();
+	bool closeOutput();
+
+	void buildGeometry();
+	void buildGeometry(ImportMesh& mesh);
+	bool areIndices16Bit() const;
+	void optimizeMeshes();
+	void generateLODs();
+	void decodePositions(const ImportMesh& mesh, Array<Vec3>& positions) const;
+	void getDominantJoints(const ImportMesh& mesh, Array<u32>& joints) const;
+
+	bool writeModel();
+	void writeModelHeader();
+	void writeMeshes();
+	void writeGeometry();
+	void writeSkeleton();
+	void writeLODs();
+	void writeBlendShapes();
+	bool writeAnimations();
+	bool writeMaterials();
+	bool findTextureSource(FbxFileTexture& texture, StaticString<MAX_PATH_LENGTH>& out) const;
+	bool writeTextures();
+	bool writePhysics();
+
+public:
+	IAllocator& allocator;
+	FbxManager* fbx_manager = nullptr;
+	Array<FbxManager*> worker_managers;
+	Array<ImportMaterial> materials;
+	Array<ImportMesh> meshes;
+	Array<ImportAnimation> animations;
+	Array<FbxNode*> bones;
+	// nodes of sources sharing a skeleton map to the bones of the first one
+	HashMap<FbxNode*, int> bone_indices;
+	// the first cluster, in mesh order, linked to a bone
+	HashMap<FbxNode*, FbxCluster*> bone_clusters;
+	Array<Skeleton> skeletons;
+	Array<FbxScene*> scenes;
+	// parallel to scenes
+	Array<SceneMemory> scene_memory;
+	// parallel to scenes, nodes of each source in the order of their bone indices
+	Array<Array<FbxNode*>> scene_bones;
+	Array<StaticString<MAX_PATH_LENGTH>> source_paths;
+	// sources added in preview mode and not loaded yet
+	Array<ScenePreview> previews;
+	Array<StageStats> stage_stats;
+	// parallel to source_paths
+	Array<FileStats> source_stats;
+	Array<FileStats> output_stats;
+	OS::Timer stage_timer;
+	Mutex stage_mutex;
+	StaticString<MAX_PATH_LENGTH> base_path;
+	StaticString<MAX_PATH_LENGTH> output_dir;
+	StaticString<MAX_PATH_LENGTH> texture_dir;
+	// where texture_dir points to on disk, converted textures are written there
+	StaticString<MAX_PATH_LENGTH> texture_output_dir;
+	StaticString<MAX_PATH_LENGTH> output_mesh_filename;
+	// empty disables the cache, entries are never evicted
+	StaticString<MAX_PATH_LENGTH> cache_dir;
+	// relative to output_dir, written or restored by the last import
+	Array<StaticString<MAX_PATH_LENGTH>> output_files;
+	// bytes the writers produced for each of output_files, empty after a restore
+	Array<u64> output_sizes;
+	float lods_distances[4] = {-10, -100, -1000, -10000};
+	bool generate_lods = false;
+	// physics meshes get one convex hull, or several if decompose_convex is set
+	bool decompose_convex = false;
+	// as if import_physics was set on every mesh
+	bool physics_all_meshes = false;
+	// relative to the mesh extent
+	float max_concavity = 0.02f;
+	u32 max_convex_hulls = 16;
+	// for generated LOD1-LOD3, simplification stops at whichever target is reached first
+	float lod_ratios[3] = {0.5f, 0.25f, 0.125f};
+	// relative to the mesh extent
+	float lod_errors[3] = {0.01f, 0.02f, 0.04f};
+	static const u32 OUTPUT_BUFFER_SIZE = 1 << 20;
+	OS::OutputFile out_file;
+	u8* out_buffer = nullptr;
+	u32 out_buffer_pos = 0;
+	bool out_error = false;
+	u64 out_size = 0;
+	float mesh_scale = 1.0f;
+	// default ImportAnimation::root_motion_bone and additive_reference of gathered animations
+	StaticString<64> root_motion_bone;
+	StaticString<MAX_PATH_LENGTH> additive_reference;
+	// max distance in world space by which a reduced animation may move any joint
+	float animation_max_error = 0.001f;
+	float bounding_shape_scale = 1.0f;
+	bool to_dds = false;
+	// color textures are BC7 instead of BC1 or BC3, depending on alpha
+	bool bc7_textures = false;
+	bool center_mesh = false;
+	bool ignore_skeleton = false;
+	// binary files are parsed by BinaryFBX instead of FbxImporter, they still become FbxScene objects
+	bool use_native_reader = false;
+	bool parallel_load = true;
+	bool preview_sources = false;
+	// give every scene its own FBX SDK arena, released in one step by clearSources
+	bool arena_scenes = false;
+	bool optimize_meshes = true;
+	// allows output the engine's loaders do not read yet, quantized vertex formats, blend shapes, quantized
+	// animation keys, root motion and additive clips; without it they are skipped with a warning
+	bool extended_formats = false;
+	bool import_blend_shapes = true;
+	Orientation orientation = Orientation::Y_UP;
+	PositionFormat position_format = PositionFormat::FLOAT;
+	UVFormat uv_format = UVFormat::FLOAT;
+	NormalFormat normal_format = NormalFormat::PACKED_U8;
+	SkinFormat skin_format = SkinFormat::FLOAT;
+	// formats of the last import, set by buildGeometry; the defaults unless extended_formats is set,
+	// skin_format also falls back when joint indices of the skeleton do not fit in it
+	PositionFormat vertex_position_format = PositionFormat::FLOAT;
+	UVFormat vertex_uv_format = UVFormat::FLOAT;
+	NormalFormat vertex_normal_format = NormalFormat::PACKED_U8;
+	SkinFormat vertex_skin_format = SkinFormat::FLOAT;
+	// vertex layout of the last import, set by buildGeometry
+	bool vertex_tangents = false;
+	bool vertex_uvs = false;
+	bool vertex_skin = false;
+	AnimationFormat animation_format = AnimationFormat::FLOAT;
+	QuantizationError quantization_error;
+};
+
+
+} // namespace Lumix
@@ -0,0 +1,276 @@
+#include "fbx_memory.h"
+#include "engine/allocator.h"
+#include "engine/atomic.h"
+#include "engine/sync.h"
+#include <fbxsdk.h>
+#include <string.h>
+
+
+namespace Lumix
+{
+
+
+namespace FBXMemory
+{
+
+
+static const u32 MAX_SLOTS = 1024;
+static const u64 CHUNK_SIZE = 4 << 20;
+static const u64 ALIGNMENT = 16;
+
+
+// precedes every allocation, keeps the returned pointer 16 byte aligned
+struct alignas(16) BlockHeader
+{
+	u64 size;
+	u32 slot;
+	u32 arena;
+};
+
+
+struct alignas(16) Chunk
+{
+	Chunk* next;
+	u64 size;
+};
+
+
+struct Counter
+{
+	volatile i64 current = 0;
+	volatile i64 peak = 0;
+};
+
+
+struct Slot
+{
+	Mutex mutex;
+	Counter counter;
+	Chunk* chunks = nullptr;
+	u64 chunk_pos = 0;
+	bool arena = false;
+	bool used = false;
+	bool destroyed = false;
+};
+
+
+static Slot slots[MAX_SLOTS];
+static Mutex slots_mutex;
+static Counter total;
+static IAllocator* engine_allocator = nullptr;
+static thread_local u32 current_slot = NO_SLOT;
+
+
+static void count(Counter& counter, i64 delta)
+{
+	// atomicAdd returns the previous value
+	const i64 value = atomicAdd(&counter.current, delta) + delta;
+	if (delta <= 0) return;
+
+	i64 peak = counter.peak;
+	while (value > peak && !compareAndExchange64(&counter.peak, value, peak)) peak = counter.peak;
+}
+
+
+static void* arenaAllocate(Slot& slot, u64 size)
+{
+	size = (size + ALIGNMENT - 1) & ~(ALIGNMENT - 1);
+	MutexGuard guard(slot.mutex);
+	if (!slot.chunks || slot.chunk_pos + size > slot.chunks->size)
+	{
+		const u64 chunk_size = size + sizeof(Chunk) > CHUNK_SIZE ? size + sizeof(Chunk) : CHUNK_SIZE;
+		Chunk* chunk = (Chunk*)engine_allocator->allocate_aligned(chunk_size, ALIGNMENT);
+		if (!chunk) return nullptr;
+		chunk->next = slot.chunks;
+		chunk->size = chunk_size;
+		slot.chunks = chunk;
+		slot.chunk_pos = sizeof(Chunk);
+	}
+	u8* ptr = (u8*)slot.chunks + slot.chunk_pos;
+	slot.chunk_pos += size;
+	return ptr;
+}
+
+
+// must be called with slots_mutex locked
+static void release(Slot& slot)
+{
+	MutexGuard guard(slot.mutex);
+	Chunk* chunk = slot.chunks;
+	while (chunk)
+	{
+		Chunk* next = chunk->next;
+		engine_allocator->deallocate_aligned(chunk);
+		chunk = next;
+	}
+	slot.chunks = nullptr;
+	slot.chunk_pos = 0;
+	slot.counter.current = 0;
+	slot.counter.peak = 0;
+	slot.used = false;
+	slot.destroyed = false;
+}
+
+
+static void* allocate(size_t size)
+{
+	const u32 slot_idx = current_slot;
+	Slot* slot = slot_idx == NO_SLOT ? nullptr : &slots[slot_idx];
+	const bool arena = slot && slot->arena;
+	const u64 block_size = sizeof(BlockHeader) + size;
+	BlockHeader* header = (BlockHeader*)(arena ? arenaAllocate(*slot, block_size) : engine_allocator->allocate_aligned(block_size, ALIGNMENT));
+	if (!header) return nullptr;
+
+	header->size = size;
+	header->slot = slot_idx;
+	header->arena = arena;
+	count(total, size);
+	if (slot) count(slot->counter, size);
+	return header + 1;
+}
+
+
+static void deallocate(void* ptr)
+{
+	if (!ptr) return;
+
+	BlockHeader* header = (BlockHeader*)ptr - 1;
+	const i64 size = (i64)header->size;
+	const u32 slot_idx = header->slot;
+	if (!header->arena) engine_allocator->deallocate_aligned(header);
+
+	count(total, -size);
+	if (slot_idx == NO_SLOT) return;
+
+	Slot& slot = slots[slot_idx];
+	if (atomicAdd(&slot.counter.current, -size) == size && slot.destroyed)
+	{
+		MutexGuard guard(slots_mutex);
+		if (slot.used && slot.destroyed && slot.counter.current == 0) release(slot);
+	}
+}
+
+
+static void* allocateZeroed(size_t count, size_t size)
+{
+	void* ptr = allocate(count * size);
+	if (ptr) memset(ptr, 0, count * size);
+	return ptr;
+}
+
+
+static void* reallocate(void* ptr, size_t size)
+{
+	if (!ptr) return allocate(size);
+	if (size == 0)
+	{
+		deallocate(ptr);
+		return nullptr;
+	}
+
+	BlockHeader* header = (BlockHeader*)ptr - 1;
+	const u64 old_size = header->size;
+	const u32 slot_idx = header->slot;
+	if (header->arena)
+	{
+		// stays in the block's slot, whichever slot the calling thread is in
+		const u32 prev = current_slot;
+		current_slot = slot_idx;
+		void* res = allocate(size);
+		current_slot = prev;
+		if (!res) return nullptr;
+		memcpy(res, ptr, old_size < size ? old_size : size);
+		deallocate(ptr);
+		return res;
+	}
+
+	header = (BlockHeader*)engine_allocator->reallocate_aligned(header, sizeof(BlockHeader) + size, ALIGNMENT);
+	if (!header) return nullptr;
+	header->size = size;
+	const i64 delta = (i64)size - (i64)old_size;
+	count(total, delta);
+	if (slot_idx != NO_SLOT) count(slots[slot_idx].counter, delta);
+	return header + 1;
+}
+
+
+void install(IAllocator& allocator)
+{
+	if (engine_allocator) return;
+	engine_allocator = &allocator;
+
+	FbxSetMallocHandler(&allocate);
+	FbxSetCallocHandler(&allocateZeroed);
+	FbxSetReallocHandler(&reallocate);
+	FbxSetFreeHandler(&deallocate);
+}
+
+
+bool isInstalled()
+{
+	return engine_allocator != nullptr;
+}
+
+
+u32 createSlot(bool arena)
+{
+	MutexGuard guard(slots_mutex);
+	for (u32 i = 0; i < MAX_SLOTS; ++i)
+	{
+		Slot& slot = slots[i];
+		if (slot.used) continue;
+
+		slot.used = true;
+		slot.destroyed = false;
+		slot.arena = arena;
+		return i;
+	}
+	return NO_SLOT;
+}
+
+
+bool destroySlot(u32 slot_idx)
+{
+	if (slot_idx == NO_SLOT) return true;
+
+	MutexGuard guard(slots_mutex);
+	Slot& slot = slots[slot_idx];
+	slot.destroyed = true;
+	if (slot.counter.current != 0) return false;
+
+	release(slot);
+	return true;
+}
+
+
+Stats getSlotStats(u32 slot_idx)
+{
+	if (slot_idx == NO_SLOT) return {0, 0};
+	const Counter& counter = slots[slot_idx].counter;
+	return {(u64)counter.current, (u64)counter.peak};
+}
+
+
+Stats getTotalStats()
+{
+	return {(u64)total.current, (u64)total.peak};
+}
+
+
+SlotScope::SlotScope(u32 slot)
+	: prev(current_slot)
+{
+	current_slot = slot;
+}
+
+
+SlotScope::~SlotScope()
+{
+	current_slot = prev;
+}
+
+
+} // namespace FBXMemory
+
+
+} // namespace Lumix
@@ -0,0 +1,55 @@
+#pragma once
+
+
+#include "engine/lumix.h"
+
+
+namespace Lumix
+{
+
+
+struct IAllocator;
+
+
+// FBX SDK allocations go through these handlers, which count them in total and per slot, e.g. per loaded scene
+namespace FBXMemory
+{
+
+
+static const u32 NO_SLOT = 0xffFFffFF;
+
+struct Stats
+{
+	u64 current;
+	u64 peak;
+};
+
+// sets the SDK's malloc handlers, must be called before anything is allocated by the SDK
+// blocks and arena chunks come from allocator, which must outlive all SDK objects; only the first call has effect
+void install(IAllocator& allocator);
+bool isInstalled();
+
+// arena slots take memory in large chunks and frees only update counters, the chunks are released
+// in one step once the slot is destroyed and nothing allocated from it is alive
+// returns NO_SLOT if there is no free slot, allocations are then only counted in total
+u32 createSlot(bool arena);
+// returns true if the slot's memory was released right away, otherwise it is released when the last
+// allocation from it is freed
+bool destroySlot(u32 slot);
+Stats getSlotStats(u32 slot);
+Stats getTotalStats();
+
+// SDK allocations made by the calling thread go to slot while the scope is alive
+struct SlotScope
+{
+	explicit SlotScope(u32 slot);
+	~SlotScope();
+
+	u32 prev;
+};
+
+
+} // namespace FBXMemory
+
+
+} // namespace Lumix
@@ -0,0 +1,714 @@
+#include "mesh_optimizer.h"
+#include "engine/allocator.h"
+#include "engine/array.h"
+#include "engine/math.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+namespace Lumix
+{
+
+
+namespace MeshOptimizer
+{
+
+
+static const u32 FORSYTH_CACHE_SIZE = 32;
+static const u32 OVERDRAW_CACHE_SIZE = 16;
+
+
+// FIFO cache simulation, vertex is in cache if it was inserted less than cache_size misses ago
+struct CacheSimulator
+{
+	CacheSimulator(u32 vertex_count, u32 cache_size, IAllocator& allocator)
+		: timestamps(allocator)
+		, cache_size(cache_size)
+		, time(cache_size + 1)
+	{
+		timestamps.resize(vertex_count);
+		memset(timestamps.begin(), 0, vertex_count * sizeof(timestamps[0]));
+	}
+
+	u32 access(u32 vertex)
+	{
+		if (time - timestamps[vertex] <= cache_size) return 0;
+		timestamps[vertex] = time;
+		++time;
+		return 1;
+	}
+
+	void reset() { time += cache_size + 1; }
+
+	Array<u32> timestamps;
+	u32 cache_size;
+	u32 time;
+};
+
+
+float computeACMR(Span<const u32> indices, u32 vertex_count, u32 cache_size, IAllocator& allocator)
+{
+	const u32 tri_count = indices.length() / 3;
+	if (tri_count == 0) return 0;
+
+	CacheSimulator cache(vertex_count, cache_size, allocator);
+	u32 misses = 0;
+	for (u32 idx : indices) misses += cache.access(idx);
+	return misses / (float)tri_count;
+}
+
+
+static float getVertexScore(i32 cache_pos, u32 live_triangles)
+{
+	if (live_triangles == 0) return -1;
+
+	float score = 0;
+	if (cache_pos >= 0)
+	{
+		// the last triangle's vertices get a fixed score so the next triangle does not just reuse them
+		if (cache_pos < 3) score = 0.75f;
+		else score = powf(1.0f - (cache_pos - 3) / float(FORSYTH_CACHE_SIZE - 3), 1.5f);
+	}
+	// prefer vertices with few remaining triangles, so they leave the working set early
+	return score + 2.0f / sqrtf((float)live_triangles);
+}
+
+
+void optimizeVertexCache(Span<u32> indices, u32 vertex_count, IAllocator& allocator)
+{
+	const u32 tri_count = indices.length() / 3;
+	if (tri_count < 2) return;
+
+	Array<u32> live(allocator);
+	Array<u32> offsets(allocator);
+	Array<u32> adjacency(allocator);
+	live.resize(vertex_count);
+	offsets.resize(vertex_count + 1);
+	adjacency.resize(indices.length());
+	memset(live.begin(), 0, vertex_count * sizeof(live[0]));
+	for (u32 idx : indices) ++live[idx];
+	offsets[0] = 0;
+	for (u32 i = 0; i < vertex_count; ++i) offsets[i + 1] = offsets[i] + live[i];
+	{
+		Array<u32> cursor(allocator);
+		cursor.resize(vertex_count);
+		memcpy(cursor.begin(), offsets.begin(), vertex_count * sizeof(cursor[0]));
+		for (u32 i = 0; i < indices.length(); ++i)
+		{
+			adjacency[cursor[indices[i]]++] = i / 3;
+		}
+	}
+
+	Array<i32> cache_pos(allocator);
+	Array<float> vertex_scores(allocator);
+	Array<float> tri_scores(allocator);
+	Array<u8> emitted(allocator);
+	cache_pos.resize(vertex_count);
+	vertex_scores.resize(vertex_count);
+	tri_scores.resize(tri_count);
+	emitted.resize(tri_count);
+	for (u32 i = 0; i < vertex_count; ++i)
+	{
+		cache_pos[i] = -1;
+		vertex_scores[i] = getVertexScore(-1, live[i]);
+	}
+
+	i32 best_tri = 0;
+	for (u32 i = 0; i < tri_count; ++i)
+	{
+		emitted[i] = 0;
+		const u32* tri = &indices[i * 3];
+		tri_scores[i] = vertex_scores[tri[0]] + vertex_scores[tri[1]] + vertex_scores[tri[2]];
+		if (tri_scores[i] > tri_scores[best_tri]) best_tri = i;
+	}
+
+	Array<u32> result(allocator);
+	result.reserve(indices.length());
+	u32 cache[FORSYTH_CACHE_SIZE + 3];
+	u32 cache_count = 0;
+	u32 input_cursor = 0;
+	for (;;)
+	{
+		if (best_tri < 0)
+		{
+			// nothing in cache has live triangles, continue with the first unprocessed triangle
+			while (input_cursor < tri_count && emitted[input_cursor]) ++input_cursor;
+			if (input_cursor == tri_count) break;
+			best_tri = input_cursor;
+		}
+
+		const u32* tri = &indices[best_tri * 3];
+		emitted[best_tri] = 1;
+		u32 new_cache[FORSYTH_CACHE_SIZE + 3];
+		u32 new_cache_count = 0;
+		for (u32 i = 0; i < 3; ++i)
+		{
+			const u32 v = tri[i];
+			result.push(v);
+			new_cache[new_cache_count++] = v;
+
+			u32* list = &adjacency[offsets[v]];
+			for (u32 j = 0; j < live[v]; ++j)
+			{
+				if (list[j] == (u32)best_tri)
+				{
+					list[j] = list[live[v] - 1];
+					break;
+				}
+			}
+			--live[v];
+		}
+		for (u32 i = 0; i < cache_count; ++i)
+		{
+			const u32 v = cache[i];
+			if (v != tri[0] && v != tri[1] && v != tri[2]) new_cache[new_cache_count++] = v;
+		}
+
+		for (u32 i = 0; i < new_cache_count; ++i)
+		{
+			const u32 v = new_cache[i];
+			cache_pos[v] = i < FORSYTH_CACHE_SIZE ? (i32)i : -1;
+			vertex_scores[v] = getVertexScore(cache_pos[v], live[v]);
+		}
+
+		best_tri = -1;
+		float best_score = -FLT_MAX;
+		for (u32 i = 0; i < new_cache_count; ++i)
+		{
+			const u32 v = new_cache[i];
+			const u32* list = &adjacency[offsets[v]];
+			for (u32 j = 0; j < live[v]; ++j)
+			{
+				const u32 t = list[j];
+				const u32* tri_indices = &indices[t * 3];
+				tri_scores[t] = vertex_scores[tri_indices[0]] + vertex_scores[tri_indices[1]] + vertex_scores[tri_indices[2]];
+				if (cache_pos[v] >= 0 && tri_scores[t] > best_score)
+				{
+					best_score = tri_scores[t];
+					best_tri = t;
+				}
+			}
+		}
+
+		cache_count = minimum(new_cache_count, FORSYTH_CACHE_SIZE);
+		memcpy(cache, new_cache, cache_count * sizeof(cache[0]));
+	}
+
+	ASSERT(result.size() == (int)indices.length());
+	memcpy(indices.begin(), result.begin(), indices.length() * sizeof(indices[0]));
+}
+
+
+struct Cluster
+{
+	float sort_key;
+	u32 index;
+	u32 begin;
+	u32 end;
+};
+
+
+static int compareClusters(const void* a, const void* b)
+{
+	const Cluster* lhs = (const Cluster*)a;
+	const Cluster* rhs = (const Cluster*)b;
+	if (lhs->sort_key != rhs->sort_key) return lhs->sort_key > rhs->sort_key ? -1 : 1;
+	return lhs->index < rhs->index ? -1 : 1;
+}
+
+
+static Vec3 getPosition(const u8* vertices, u32 stride, u32 idx)
+{
+	Vec3 pos;
+	memcpy(&pos, vertices + idx * stride, sizeof(pos));
+	return pos;
+}
+
+
+void optimizeOverdraw(Span<u32> indices, const u8* vertices, u32 stride, u32 vertex_count, float threshold, IAllocator& allocator)
+{
+	const u32 tri_count = indices.length() / 3;
+	if (tri_count < 2) return;
+
+	// hard boundaries are where the cache starts from scratch anyway - all three vertices miss
+	Array<u32> hard_boundaries(allocator);
+	CacheSimulator cache(vertex_count, OVERDRAW_CACHE_SIZE, allocator);
+	for (u32 i = 0; i < tri_count; ++i)
+	{
+		const u32* tri = &indices[i * 3];
+		const u32 misses = cache.access(tri[0]) + cache.access(tri[1]) + cache.access(tri[2]);
+		if (i == 0 || misses == 3) hard_boundaries.push(i);
+	}
+	hard_boundaries.push(tri_count);
+
+	// soft boundaries split hard clusters wherever it does not make their ACMR worse than threshold
+	Array<Cluster> clusters(allocator);
+	for (int i = 0; i < hard_boundaries.size() - 1; ++i)
+	{
+		const u32 begin = hard_boundaries[i];
+		const u32 end = hard_boundaries[i + 1];
+		cache.reset();
+		u32 misses = 0;
+		for (u32 t = begin; t < end; ++t)
+		{
+			const u32* tri = &indices[t * 3];
+			misses += cache.access(tri[0]) + cache.access(tri[1]) + cache.access(tri[2]);
+		}
+		const float max_acmr = threshold * misses / float(end - begin);
+
+		cache.reset();
+		u32 cluster_begin = begin;
+		misses = 0;
+		for (u32 t = begin; t < end; ++t)
+		{
+			const u32* tri = &indices[t * 3];
+			misses += cache.access(tri[0]) + cache.access(tri[1]) + cache.access(tri[2]);
+			if (t + 1 < end && misses / float(t + 1 - cluster_begin) <= max_acmr)
+			{
+				clusters.push({0, (u32)clusters.size(), cluster_begin, t + 1});
+				cluster_begin = t + 1;
+				misses = 0;
+				cache.reset();
+			}
+		}
+		clusters.push({0, (u32)clusters.size(), cluster_begin, end});
+	}
+	if (clusters.size() < 2) return;
+
+	Vec3 mesh_centroid(0, 0, 0);
+	float mesh_area = 0;
+	for (u32 i = 0; i < tri_count; ++i)
+	{
+		const u32* tri = &indices[i * 3];
+		const Vec3 p0 = getPosition(vertices, stride, tri[0]);
+		const Vec3 p1 = getPosition(vertices, stride, tri[1]);
+		const Vec3 p2 = getPosition(vertices, stride, tri[2]);
+		const float area = crossProduct(p1 - p0, p2 - p0).length();
+		mesh_centroid += (p0 + p1 + p2) * area;
+		mesh_area += area;
+	}
+	if (mesh_area > 0) mesh_centroid *= 1 / (3 * mesh_area);
+
+	// clusters facing away from the mesh's center are likely to occlude the rest, draw them first
+	for (Cluster& cluster : clusters)
+	{
+		Vec3 centroid(0, 0, 0);
+		Vec3 normal(0, 0, 0);
+		float area = 0;
+		for (u32 t = cluster.begin; t < cluster.end; ++t)
+		{
+			const u32* tri = &indices[t * 3];
+			const Vec3 p0 = getPosition(vertices, stride, tri[0]);
+			const Vec3 p1 = getPosition(vertices, stride, tri[1]);
+			const Vec3 p2 = getPosition(vertices, stride, tri[2]);
+			const Vec3 n = crossProduct(p1 - p0, p2 - p0);
+			const float tri_area = n.length();
+			centroid += (p0 + p1 + p2) * tri_area;
+			normal += n;
+			area += tri_area;
+		}
+		if (area > 0) centroid *= 1 / (3 * area);
+		const float normal_length = normal.length();
+		if (normal_length > 0) normal *= 1 / normal_length;
+		cluster.sort_key = dotProduct(centroid - mesh_centroid, normal);
+	}
+	qsort(clusters.begin(), clusters.size(), sizeof(clusters[0]), compareClusters);
+
+	Array<u32> result(allocator);
+	result.reserve(indices.length());
+	for (const Cluster& cluster : clusters)
+	{
+		for (u32 i = cluster.begin * 3; i < cluster.end * 3; ++i) result.push(indices[i]);
+	}
+	memcpy(indices.begin(), result.begin(), indices.length() * sizeof(indices[0]));
+}
+
+
+u32 optimizeVertexFetch(Span<u32> indices, u8* vertices, u32 stride, u32 vertex_count, IAllocator& allocator)
+{
+	Array<u32> remap(allocator);
+	Array<u8> original(allocator);
+	remap.resize(vertex_count);
+	original.resize(vertex_count * stride);
+	memset(remap.begin(), 0xff, vertex_count * sizeof(remap[0]));
+	memcpy(original.begin(), vertices, vertex_count * stride);
+
+	u32 next = 0;
+	for (u32& idx : indices)
+	{
+		if (remap[idx] == 0xffFFffFF)
+		{
+			remap[idx] = next;
+			memcpy(vertices + next * stride, &original[idx * stride], stride);
+			++next;
+		}
+		idx = remap[idx];
+	}
+	return next;
+}
+
+
+struct Quadric
+{
+	void addPlane(const Vec3& n, float d, float weight)
+	{
+		a00 += weight * n.x * n.x;
+		a01 += weight * n.x * n.y;
+		a02 += weight * n.x * n.z;
+		a11 += weight * n.y * n.y;
+		a12 += weight * n.y * n.z;
+		a22 += weight * n.z * n.z;
+		b0 += weight * n.x * d;
+		b1 += weight * n.y * d;
+		b2 += weight * n.z * d;
+		c += weight * d * d;
+		w += weight;
+	}
+
+	void add(const Quadric& rhs)
+	{
+		a00 += rhs.a00;
+		a01 += rhs.a01;
+		a02 += rhs.a02;
+		a11 += rhs.a11;
+		a12 += rhs.a12;
+		a22 += rhs.a22;
+		b0 += rhs.b0;
+		b1 += rhs.b1;
+		b2 += rhs.b2;
+		c += rhs.c;
+		w += rhs.w;
+	}
+
+	// weighted average of squared distances to the accumulated planes
+	float getError(const Vec3& v) const
+	{
+		if (w <= 0) return 0;
+		const float rx = a00 * v.x + a01 * v.y + a02 * v.z;
+		const float ry = a01 * v.x + a11 * v.y + a12 * v.z;
+		const float rz = a02 * v.x + a12 * v.y + a22 * v.z;
+		const float err = v.x * rx + v.y * ry + v.z * rz + 2 * (b0 * v.x + b1 * v.y + b2 * v.z) + c;
+		return fabsf(err) / w;
+	}
+
+	float a00 = 0, a01 = 0, a02 = 0, a11 = 0, a12 = 0, a22 = 0;
+	float b0 = 0, b1 = 0, b2 = 0;
+	float c = 0;
+	float w = 0;
+};
+
+
+struct Collapse
+{
+	u32 from;
+	u32 to;
+	float error;
+};
+
+
+static int compareCollapses(const void* a, const void* b)
+{
+	const Collapse* lhs = (const Collapse*)a;
+	const Collapse* rhs = (const Collapse*)b;
+	if (lhs->error != rhs->error) return lhs->error < rhs->error ? -1 : 1;
+	if (lhs->from != rhs->from) return lhs->from < rhs->from ? -1 : 1;
+	return lhs->to < rhs->to ? -1 : 1;
+}
+
+
+// open addressing set of u64 keys
+struct KeySet
+{
+	KeySet(u32 max_count, IAllocator& allocator)
+		: keys(allocator)
+	{
+		u32 size = 1;
+		while (size < max_count * 2) size <<= 1;
+		keys.resize(size);
+		memset(keys.begin(), 0xff, size * sizeof(keys[0]));
+	}
+
+	static u32 hash(u64 key)
+	{
+		key ^= key >> 33;
+		key *= 0xff51afd7ed558ccdULL;
+		key ^= key >> 33;
+		return (u32)key;
+	}
+
+	// returns false if the key was already in the set
+	bool insert(u64 key)
+	{
+		const u32 mask = keys.size() - 1;
+		for (u32 slot = hash(key) & mask;; slot = (slot + 1) & mask)
+		{
+			if (keys[slot] == key) return false;
+			if (keys[slot] == EMPTY)
+			{
+				keys[slot] = key;
+				return true;
+			}
+		}
+	}
+
+	bool contains(u64 key) const
+	{
+		const u32 mask = keys.size() - 1;
+		for (u32 slot = hash(key) & mask;; slot = (slot + 1) & mask)
+		{
+			if (keys[slot] == key) return true;
+			if (keys[slot] == EMPTY) return false;
+		}
+	}
+
+	static const u64 EMPTY = ~0ULL;
+	Array<u64> keys;
+};
+
+
+static u64 getEdgeKey(u32 a, u32 b)
+{
+	return ((u64)a << 32) | b;
+}
+
+
+static u64 getPositionKey(const Vec3& p)
+{
+	u32 bits[3];
+	memcpy(bits, &p, sizeof(bits));
+	// full 96 bits do not fit, collisions are resolved by comparing positions
+	return ((u64)bits[0] << 32) ^ ((u64)bits[1] << 16) ^ bits[2];
+}
+
+
+static void lockSeamsAndBorders(Span<const u32> indices, Span<const Vec3> positions, Array<u8>& locked, IAllocator& allocator)
+{
+	const u32 vertex_count = positions.length();
+
+	// first vertex with each position, vertex index + 1, 0 is an empty slot
+	u32 table_size = 1;
+	while (table_size < vertex_count * 2) table_size <<= 1;
+	Array<u32> table(allocator);
+	table.resize(table_size);
+	memset(table.begin(), 0, table_size * sizeof(table[0]));
+	for (u32 i = 0; i < vertex_count; ++i)
+	{
+		const Vec3& p = positions[i];
+		for (u32 slot = KeySet::hash(getPositionKey(p)) & (table_size - 1);; slot = (slot + 1) & (table_size - 1))
+		{
+			const u32 value = table[slot];
+			if (value == 0)
+			{
+				table[slot] = i + 1;
+				break;
+			}
+			if (memcmp(&positions[value - 1], &p, sizeof(p)) == 0)
+			{
+				locked[value - 1] = 1;
+				locked[i] = 1;
+				break;
+			}
+		}
+	}
+
+	KeySet edges(indices.length(), allocator);
+	for (u32 i = 0; i < indices.length(); i += 3)
+	{
+		for (u32 j = 0; j < 3; ++j)
+		{
+			edges.insert(getEdgeKey(indices[i + j], indices[i + (j + 1) % 3]));
+		}
+	}
+	for (u32 i = 0; i < indices.length(); i += 3)
+	{
+		for (u32 j = 0; j < 3; ++j)
+		{
+			const u32 a = indices[i + j];
+			const u32 b = indices[i + (j + 1) % 3];
+			if (!edges.contains(getEdgeKey(b, a)))
+			{
+				locked[a] = 1;
+				locked[b] = 1;
+			}
+		}
+	}
+}
+
+
+// would moving from to to's position flip any triangle which does not collapse
+static bool flipsTriangle(const u32* indices,
+	const u32* adjacency,
+	u32 adjacency_count,
+	u32 from,
+	u32 to,
+	const Array<Vec3>& positions)
+{
+	for (u32 i = 0; i < adjacency_count; ++i)
+	{
+		const u32* tri = &indices[adjacency[i] * 3];
+		if (tri[0] == to || tri[1] == to || tri[2] == to) continue;
+
+		Vec3 before[3];
+		Vec3 after[3];
+		for (u32 j = 0; j < 3; ++j)
+		{
+			before[j] = positions[tri[j]];
+			after[j] = tri[j] == from ? positions[to] : before[j];
+		}
+		const Vec3 n0 = crossProduct(before[1] - before[0], before[2] - before[0]);
+		const Vec3 n1 = crossProduct(after[1] - after[0], after[2] - after[0]);
+		if (dotProduct(n0, n1) <= 0) return true;
+	}
+	return false;
+}
+
+
+u32 simplify(Span<u32> out,
+	Span<const u32> indices,
+	Span<const Vec3> positions,
+	const u32* vertex_groups,
+	u32 target_index_count,
+	float target_error,
+	float* result_error,
+	IAllocator& allocator)
+{
+	ASSERT(out.length() >= indices.length());
+	u32 index_count = indices.length();
+	memcpy(out.begin(), indices.begin(), index_count * sizeof(out[0]));
+	if (result_error) *result_error = 0;
+	const u32 vertex_count = positions.length();
+	if (index_count <= target_index_count || vertex_count == 0) return index_count;
+
+	// work in unit scale so target_error is relative to the mesh size
+	Vec3 min(FLT_MAX, FLT_MAX, FLT_MAX);
+	Vec3 max(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+	for (const Vec3& p : positions)
+	{
+		min = {minimum(min.x, p.x), minimum(min.y, p.y), minimum(min.z, p.z)};
+		max = {maximum(max.x, p.x), maximum(max.y, p.y), maximum(max.z, p.z)};
+	}
+	const float extent = maximum(max.x - min.x, maximum(max.y - min.y, max.z - min.z));
+	if (extent <= 0) return index_count;
+
+	Array<Vec3> normalized(allocator);
+	normalized.resize(vertex_count);
+	for (u32 i = 0; i < vertex_count; ++i) normalized[i] = (positions[i] - min) * (1 / extent);
+
+	Array<u8> locked(allocator);
+	locked.resize(vertex_count);
+	memset(locked.begin(), 0, vertex_count);
+	lockSeamsAndBorders(indices, positions, locked, allocator);
+
+	Array<Quadric> quadrics(allocator);
+	quadrics.resize(vertex_count);
+	for (u32 i = 0; i < index_count; i += 3)
+	{
+		const Vec3& p0 = normalized[out[i]];
+		const Vec3& p1 = normalized[out[i + 1]];
+		const Vec3& p2 = normalized[out[i + 2]];
+		Vec3 n = crossProduct(p1 - p0, p2 - p0);
+		const float area = n.length();
+		if (area <= 0) continue;
+		n *= 1 / area;
+		for (u32 j = 0; j < 3; ++j) quadrics[out[i + j]].addPlane(n, -dotProduct(n, p0), area);
+	}
+
+	const float max_error = target_error * target_error;
+	float error = 0;
+	Array<u32> live(allocator);
+	Array<u32> offsets(allocator);
+	Array<u32> adjacency(allocator);
+	Array<Collapse> collapses(allocator);
+	Array<u32> remap(allocator);
+	Array<u8> touched(allocator);
+	live.resize(vertex_count);
+	offsets.resize(vertex_count + 1);
+	remap.resize(vertex_count);
+	touched.resize(vertex_count);
+	while (index_count > target_index_count)
+	{
+		memset(live.begin(), 0, vertex_count * sizeof(live[0]));
+		for (u32 i = 0; i < index_count; ++i) ++live[out[i]];
+		offsets[0] = 0;
+		for (u32 i = 0; i < vertex_count; ++i) offsets[i + 1] = offsets[i] + live[i];
+		adjacency.resize(index_count);
+		memset(live.begin(), 0, vertex_count * sizeof(live[0]));
+		for (u32 i = 0; i < index_count; ++i)
+		{
+			const u32 v = out[i];
+			adjacency[offsets[v] + live[v]++] = i / 3;
+		}
+
+		collapses.clear();
+		for (u32 i = 0; i < index_count; i += 3)
+		{
+			for (u32 j = 0; j < 3; ++j)
+			{
+				const u32 a = out[i + j];
+				const u32 b = out[i + (j + 1) % 3];
+				for (u32 k = 0; k < 2; ++k)
+				{
+					const u32 from = k == 0 ? a : b;
+					const u32 to = k == 0 ? b : a;
+					if (locked[from]) continue;
+					if (vertex_groups && vertex_groups[from] != vertex_groups[to]) continue;
+
+					Quadric q = quadrics[from];
+					q.add(quadrics[to]);
+					collapses.push({from, to, q.getError(normalized[to])});
+				}
+			}
+		}
+		if (collapses.empty()) break;
+		qsort(collapses.begin(), collapses.size(), sizeof(collapses[0]), compareCollapses);
+
+		for (u32 i = 0; i < vertex_count; ++i) remap[i] = i;
+		memset(touched.begin(), 0, vertex_count);
+		// each collapse removes about two triangles
+		const u32 max_collapses = (index_count - target_index_count) / 6 + 1;
+		u32 collapse_count = 0;
+		for (const Collapse& collapse : collapses)
+		{
+			if (collapse.error > max_error || collapse_count >= max_collapses) break;
+			if (touched[collapse.from] || touched[collapse.to]) continue;
+
+			const u32* from_adjacency = &adjacency[offsets[collapse.from]];
+			if (flipsTriangle(out.begin(), from_adjacency, live[collapse.from], collapse.from, collapse.to, normalized)) continue;
+
+			remap[collapse.from] = collapse.to;
+			quadrics[collapse.to].add(quadrics[collapse.from]);
+			error = maximum(error, collapse.error);
+			++collapse_count;
+			// neighbours' triangles change, so they can not be validated against stale adjacency in this pass
+			for (u32 i = 0; i < live[collapse.from]; ++i)
+			{
+				const u32* tri = &out[from_adjacency[i] * 3];
+				touched[tri[0]] = touched[tri[1]] = touched[tri[2]] = 1;
+			}
+		}
+		if (collapse_count == 0) break;
+
+		u32 write = 0;
+		for (u32 i = 0; i < index_count; i += 3)
+		{
+			const u32 a = remap[out[i]];
+			const u32 b = remap[out[i + 1]];
+			const u32 c = remap[out[i + 2]];
+			if (a == b || b == c || c == a) continue;
+			out[write++] = a;
+			out[write++] = b;
+			out[write++] = c;
+		}
+		index_count = write;
+	}
+
+	if (result_error) *result_error = sqrtf(error) * extent;
+	return index_count;
+}
+
+
+} // namespace MeshOptimizer
+
+
+} // namespace Lumix
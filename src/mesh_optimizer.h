@@ -0,0 +1,51 @@
+#pragma once
+
+
+#include "engine/lumix.h"
+#include "engine/math.h"
+
+
+namespace Lumix
+{
+
+
+struct IAllocator;
+
+
+namespace MeshOptimizer
+{
+
+
+// average cache miss ratio - vertex shader invocations per triangle with a FIFO cache of cache_size entries
+float computeACMR(Span<const u32> indices, u32 vertex_count, u32 cache_size, IAllocator& allocator);
+
+// reorders triangles for post-transform vertex cache locality (Forsyth's linear-speed algorithm)
+void optimizeVertexCache(Span<u32> indices, u32 vertex_count, IAllocator& allocator);
+
+// splits the cache optimized triangle list into clusters and sorts them so outward-facing ones are drawn first
+// threshold is how much the ACMR is allowed to degrade, e.g. 1.05 == 5% worse
+// positions are the first 3 floats of every vertex
+void optimizeOverdraw(Span<u32> indices, const u8* vertices, u32 stride, u32 vertex_count, float threshold, IAllocator& allocator);
+
+// reorders vertices in order of first use and remaps indices, returns number of referenced vertices
+u32 optimizeVertexFetch(Span<u32> indices, u8* vertices, u32 stride, u32 vertex_count, IAllocator& allocator);
+
+// quadric edge collapse simplification, collapses vertices into their neighbours so vertex attributes stay valid
+// stops at target_index_count or when the error relative to the mesh extent would exceed target_error
+// vertices sharing a position with another vertex (attribute seams) and vertices on open borders never move
+// vertex_groups, if not null, allows collapses only between vertices of the same group
+// out must have room for indices.length() indices, returns the number of indices written
+u32 simplify(Span<u32> out,
+	Span<const u32> indices,
+	Span<const Vec3> positions,
+	const u32* vertex_groups,
+	u32 target_index_count,
+	float target_error,
+	float* result_error,
+	IAllocator& allocator);
+
+
+} // namespace MeshOptimizer
+
+
+} // namespace Lumix
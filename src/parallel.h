@@ -0,0 +1,67 @@
+#pragma once
+
+
+#include "engine/atomic.h"
+#include "engine/job_system.h"
+#include "engine/math.h"
+
+
+namespace Lumix
+{
+
+
+// number of distinct worker indices parallelForWorkers passes for count items
+inline i32 getParallelWorkersCount(i32 count)
+{
+	return maximum(1, minimum(count, (i32)JobSystem::getWorkersCount()));
+}
+
+
+// calls f(worker, i) for every i in [0, count) on job system workers, returns when all calls are finished
+// worker is in [0, getParallelWorkersCount(count)) and no two concurrent calls share it
+template <typename F> void parallelForWorkers(i32 count, const F& f)
+{
+	if (count <= 0) return;
+	if (count == 1)
+	{
+		f(0, 0);
+		return;
+	}
+
+	struct Context
+	{
+		const F* f;
+		i32 count;
+		volatile i32 next;
+		volatile i32 worker;
+	} ctx = {&f, count, 0, 0};
+
+	JobSystem::SignalHandle signal = JobSystem::INVALID_HANDLE;
+	const i32 workers = getParallelWorkersCount(count);
+	for (i32 i = 0; i < workers; ++i)
+	{
+		JobSystem::run(&ctx,
+			[](void* data) {
+				Context* ctx = (Context*)data;
+				const i32 worker = atomicIncrement(&ctx->worker) - 1;
+				for (;;)
+				{
+					const i32 idx = atomicIncrement(&ctx->next) - 1;
+					if (idx >= ctx->count) break;
+					(*ctx->f)(worker, idx);
+				}
+			},
+			&signal);
+	}
+	JobSystem::wait(signal);
+}
+
+
+// calls f(i) for every i in [0, count) on job system workers, returns when all calls are finished
+template <typename F> void parallelFor(i32 count, const F& f)
+{
+	parallelForWorkers(count, [&f](i32, i32 idx) { f(idx); });
+}
+
+
+} // namespace Lumix
@@ -0,0 +1,561 @@
+#include "physics_cooker.h"
+#include "engine/allocator.h"
+#include <float.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+namespace Lumix
+{
+
+
+namespace PhysicsCooker
+{
+
+
+struct WeldVertex
+{
+	Vec3 pos;
+	u32 idx;
+};
+
+
+static int compareWeldVertices(const void* a, const void* b)
+{
+	const Vec3& pa = ((const WeldVertex*)a)->pos;
+	const Vec3& pb = ((const WeldVertex*)b)->pos;
+	const int res = memcmp(&pa, &pb, sizeof(pa));
+	if (res != 0) return res;
+	return ((const WeldVertex*)a)->idx < ((const WeldVertex*)b)->idx ? -1 : 1;
+}
+
+
+void weldPositions(Span<const Vec3> positions, Array<Vec3>& out, Array<u32>& remap, IAllocator& allocator)
+{
+	const u32 count = positions.length();
+	Array<WeldVertex> sorted(allocator);
+	sorted.resize(count);
+	for (u32 i = 0; i < count; ++i) sorted[i] = {positions[i], i};
+	qsort(sorted.begin(), count, sizeof(sorted[0]), compareWeldVertices);
+
+	out.clear();
+	remap.resize(count);
+	for (u32 i = 0; i < count; ++i)
+	{
+		if (i == 0 || memcmp(&sorted[i].pos, &sorted[i - 1].pos, sizeof(Vec3)) != 0) out.push(sorted[i].pos);
+		remap[sorted[i].idx] = out.size() - 1;
+	}
+}
+
+
+struct HullFace
+{
+	u32 v[3];
+	Vec3 normal;
+	float d;
+	bool alive;
+};
+
+
+struct HullBuilder
+{
+	HullBuilder(Span<const Vec3> points, IAllocator& allocator)
+		: points(points)
+		, faces(allocator)
+		, owner(allocator)
+		, distance(allocator)
+		, vertices(allocator)
+		, horizon(allocator)
+		, stack(allocator)
+		, remap(allocator)
+	{
+	}
+
+	float getDistance(const HullFace& face, const Vec3& p) const { return dotProduct(face.normal, p) - face.d; }
+
+	void addFace(u32 a, u32 b, u32 c)
+	{
+		HullFace& face = faces.emplace();
+		face.v[0] = a;
+		face.v[1] = b;
+		face.v[2] = c;
+		face.normal = crossProduct(points[b] - points[a], points[c] - points[a]).normalized();
+		face.d = dotProduct(face.normal, points[a]);
+		face.alive = true;
+	}
+
+	// assigns the point to the face it is farthest in front of, among faces [first_face, faces.size())
+	void assign(u32 point, int first_face)
+	{
+		owner[point] = -1;
+		distance[point] = epsilon;
+		for (int i = first_face; i < faces.size(); ++i)
+		{
+			if (!faces[i].alive) continue;
+			const float dist = getDistance(faces[i], points[point]);
+			if (dist > distance[point])
+			{
+				distance[point] = dist;
+				owner[point] = i;
+			}
+		}
+	}
+
+	bool initSimplex()
+	{
+		const u32 count = points.length();
+		if (count < 4) return false;
+
+		u32 min_x = 0, max_x = 0;
+		Vec3 min = points[0], max = points[0];
+		for (u32 i = 1; i < count; ++i)
+		{
+			const Vec3& p = points[i];
+			if (p.x < points[min_x].x) min_x = i;
+			if (p.x > points[max_x].x) max_x = i;
+			min = {minimum(min.x, p.x), minimum(min.y, p.y), minimum(min.z, p.z)};
+			max = {maximum(max.x, p.x), maximum(max.y, p.y), maximum(max.z, p.z)};
+		}
+		const float extent = (max - min).length();
+		epsilon = extent * 1e-5f;
+		if (extent == 0) return false;
+
+		u32 a = min_x, b = max_x;
+		if (a == b) return false;
+		const Vec3 ab = (points[b] - points[a]).normalized();
+
+		u32 c = a;
+		float best = 0;
+		for (u32 i = 0; i < count; ++i)
+		{
+			const Vec3 ap = points[i] - points[a];
+			const float dist = (ap - ab * dotProduct(ap, ab)).squaredLength();
+			if (dist > best)
+			{
+				best = dist;
+				c = i;
+			}
+		}
+		if (best <= epsilon * epsilon) return false;
+
+		const Vec3 n = crossProduct(points[b] - points[a], points[c] - points[a]).normalized();
+		u32 d = a;
+		best = 0;
+		for (u32 i = 0; i < count; ++i)
+		{
+			const float dist = fabsf(dotProduct(points[i] - points[a], n));
+			if (dist > best)
+			{
+				best = dist;
+				d = i;
+			}
+		}
+		if (best <= epsilon) return false;
+
+		// faces wind counter clockwise seen from outside
+		if (dotProduct(points[d] - points[a], n) > 0)
+		{
+			const u32 tmp = b;
+			b = c;
+			c = tmp;
+		}
+		addFace(a, b, c);
+		addFace(a, d, b);
+		addFace(b, d, c);
+		addFace(c, d, a);
+		vertices.push(a);
+		vertices.push(b);
+		vertices.push(c);
+		vertices.push(d);
+
+		owner.resize(count);
+		distance.resize(count);
+		for (u32 i = 0; i < count; ++i) assign(i, 0);
+		return true;
+	}
+
+	bool build(u32 max_vertices)
+	{
+		if (!initSimplex()) return false;
+
+		const u32 count = points.length();
+		while ((u32)vertices.size() < max_vertices)
+		{
+			int eye = -1;
+			float best = 0;
+			for (u32 i = 0; i < count; ++i)
+			{
+				if (owner[i] >= 0 && distance[i] > best)
+				{
+					best = distance[i];
+					eye = i;
+				}
+			}
+			if (eye < 0) break;
+
+			addVertex(eye);
+		}
+		return true;
+	}
+
+	int findFace(u32 a, u32 b) const
+	{
+		for (int i = 0; i < faces.size(); ++i)
+		{
+			const HullFace& face = faces[i];
+			if (!face.alive) continue;
+			for (u32 j = 0; j < 3; ++j)
+			{
+				if (face.v[j] == a && face.v[(j + 1) % 3] == b) return i;
+			}
+		}
+		return -1;
+	}
+
+	// visible faces are flood filled from the eye's face, so they form one connected region
+	void addVertex(u32 eye)
+	{
+		const Vec3& p = points[eye];
+		horizon.clear();
+		stack.clear();
+		stack.push(owner[eye]);
+		faces[owner[eye]].alive = false;
+		while (!stack.empty())
+		{
+			const HullFace face = faces[stack.back()];
+			stack.pop();
+			for (u32 j = 0; j < 3; ++j)
+			{
+				const u32 a = face.v[j];
+				const u32 b = face.v[(j + 1) % 3];
+				const int neighbour = findFace(b, a);
+				if (neighbour < 0) continue;
+				if (getDistance(faces[neighbour], p) > epsilon)
+				{
+					faces[neighbour].alive = false;
+					stack.push(neighbour);
+				}
+				else
+				{
+					horizon.push({a, b});
+				}
+			}
+		}
+
+		const int first_face = faces.size();
+		for (const Edge& edge : horizon) addFace(edge.a, edge.b, eye);
+		vertices.push(eye);
+
+		owner[eye] = -1;
+		for (u32 i = 0; i < points.length(); ++i)
+		{
+			if (owner[i] >= 0 && !faces[owner[i]].alive) assign(i, first_face);
+		}
+
+		// drop dead faces so the searches only see the current hull
+		remap.resize(faces.size());
+		int count = 0;
+		for (int i = 0; i < faces.size(); ++i)
+		{
+			remap[i] = count;
+			if (faces[i].alive) faces[count++] = faces[i];
+		}
+		faces.resize(count);
+		for (int& face : owner)
+		{
+			if (face >= 0) face = remap[face];
+		}
+	}
+
+	struct Edge
+	{
+		u32 a;
+		u32 b;
+	};
+
+	Span<const Vec3> points;
+	Array<HullFace> faces;
+	// face each point is outside of, -1 for points inside the hull
+	Array<int> owner;
+	Array<float> distance;
+	Array<u32> vertices;
+	Array<Edge> horizon;
+	Array<int> stack;
+	Array<int> remap;
+	float epsilon = 0;
+};
+
+
+bool computeConvexHull(Span<const Vec3> points, u32 max_vertices, ConvexHull& hull, IAllocator& allocator)
+{
+	HullBuilder builder(points, allocator);
+	if (!builder.build(maximum(max_vertices, 4u))) return false;
+
+	Array<int> remap(allocator);
+	remap.resize(points.length());
+	for (int& idx : remap) idx = -1;
+
+	hull.vertices.clear();
+	hull.indices.clear();
+	for (const HullFace& face : builder.faces)
+	{
+		if (!face.alive) continue;
+		for (u32 v : face.v)
+		{
+			if (remap[v] < 0)
+			{
+				remap[v] = hull.vertices.size();
+				hull.vertices.push(points[v]);
+			}
+			hull.indices.push((u16)remap[v]);
+		}
+	}
+	return true;
+}
+
+
+// how deep the deepest point lies under the hull's surface, 0 for points on a convex surface
+static float getConcavity(const ConvexHull& hull, Span<const Vec3> points)
+{
+	float concavity = 0;
+	for (const Vec3& p : points)
+	{
+		float depth = FLT_MAX;
+		for (int i = 0; i < hull.indices.size(); i += 3)
+		{
+			const Vec3& a = hull.vertices[hull.indices[i]];
+			const Vec3& b = hull.vertices[hull.indices[i + 1]];
+			const Vec3& c = hull.vertices[hull.indices[i + 2]];
+			const Vec3 n = crossProduct(b - a, c - a).normalized();
+			depth = minimum(depth, dotProduct(n, a - p));
+		}
+		concavity = maximum(concavity, depth);
+	}
+	return concavity;
+}
+
+
+// splits triangle a, b, c by the plane where the axis coordinate equals mid, new vertices are appended to vertices
+static void clipTriangle(const u32* tri, int axis, float mid, Array<Vec3>& vertices, Array<u32>& front, Array<u32>& back)
+{
+	u32 front_poly[4], back_poly[4];
+	u32 front_count = 0, back_count = 0;
+	for (u32 i = 0; i < 3; ++i)
+	{
+		const u32 a = tri[i];
+		const u32 b = tri[(i + 1) % 3];
+		const float da = (&vertices[a].x)[axis] - mid;
+		const float db = (&vertices[b].x)[axis] - mid;
+		if (da >= 0) front_poly[front_count++] = a;
+		else back_poly[back_count++] = a;
+		if ((da >= 0) != (db >= 0))
+		{
+			const Vec3 p = vertices[a] + (vertices[b] - vertices[a]) * (da / (da - db));
+			const u32 idx = vertices.size();
+			vertices.push(p);
+			front_poly[front_count++] = idx;
+			back_poly[back_count++] = idx;
+		}
+	}
+	for (u32 i = 2; i < front_count; ++i)
+	{
+		front.push(front_poly[0]);
+		front.push(front_poly[i - 1]);
+		front.push(front_poly[i]);
+	}
+	for (u32 i = 2; i < back_count; ++i)
+	{
+		back.push(back_poly[0]);
+		back.push(back_poly[i - 1]);
+		back.push(back_poly[i]);
+	}
+}
+
+
+void decompose(Span<const Vec3> positions,
+	Span<const u32> indices,
+	float max_concavity,
+	u32 max_hulls,
+	u32 max_vertices,
+	Array<ConvexHull>& hulls,
+	IAllocator& allocator)
+{
+	Vec3 min(FLT_MAX, FLT_MAX, FLT_MAX), max(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+	for (const Vec3& p : positions)
+	{
+		min = {minimum(min.x, p.x), minimum(min.y, p.y), minimum(min.z, p.z)};
+		max = {maximum(max.x, p.x), maximum(max.y, p.y), maximum(max.z, p.z)};
+	}
+	const float threshold = max_concavity * (max - min).length();
+
+	// pieces are triangle lists, processed breadth first so the hull budget is spread evenly
+	// triangles crossing a split plane are clipped, the new vertices are appended to vertices
+	Array<Vec3> vertices(allocator);
+	vertices.resize(positions.length());
+	memcpy(vertices.begin(), positions.begin(), positions.length() * sizeof(Vec3));
+	Array<Array<u32>> pieces(allocator);
+	Array<u32>& all = pieces.emplace(allocator);
+	all.resize(indices.length());
+	memcpy(all.begin(), indices.begin(), indices.length() * sizeof(u32));
+
+	Array<u32> marks(allocator);
+	Array<Vec3> points(allocator);
+	for (int piece_idx = 0; piece_idx < pieces.size(); ++piece_idx)
+	{
+		while (marks.size() < vertices.size()) marks.push(0xffFFffFF);
+		points.clear();
+		Vec3 piece_min(FLT_MAX, FLT_MAX, FLT_MAX), piece_max(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+		for (u32 v : pieces[piece_idx])
+		{
+			if (marks[v] == (u32)piece_idx) continue;
+			marks[v] = piece_idx;
+			const Vec3& p = vertices[v];
+			points.push(p);
+			piece_min = {minimum(piece_min.x, p.x), minimum(piece_min.y, p.y), minimum(piece_min.z, p.z)};
+			piece_max = {maximum(piece_max.x, p.x), maximum(piece_max.y, p.y), maximum(piece_max.z, p.z)};
+		}
+
+		ConvexHull hull(allocator);
+		if (!computeConvexHull(Span<const Vec3>(points.begin(), points.end()), max_vertices, hull, allocator)) continue;
+
+		// vertices of a concave part can all lie on its hull, e.g. in an L shape, but face centers do not
+		const Array<u32>& piece = pieces[piece_idx];
+		for (int i = 0; i < piece.size(); i += 3)
+		{
+			points.push((vertices[piece[i]] + vertices[piece[i + 1]] + vertices[piece[i + 2]]) * (1 / 3.0f));
+		}
+
+		const u32 pending = u32(pieces.size() - piece_idx - 1);
+		const bool can_split = hulls.size() + pending + 2 <= max_hulls;
+		if (!can_split || getConcavity(hull, Span<const Vec3>(points.begin(), points.end())) <= threshold)
+		{
+			hulls.emplace(static_cast<ConvexHull&&>(hull));
+			continue;
+		}
+
+		const Vec3 size = piece_max - piece_min;
+		const int axis = size.x > size.y ? (size.x > size.z ? 0 : 2) : (size.y > size.z ? 1 : 2);
+		const float mid = (&piece_min.x)[axis] + (&size.x)[axis] * 0.5f;
+		Array<u32> front(allocator);
+		Array<u32> back(allocator);
+		for (int i = 0; i < piece.size(); i += 3) clipTriangle(&piece[i], axis, mid, vertices, front, back);
+		if (front.empty() || back.empty())
+		{
+			hulls.emplace(static_cast<ConvexHull&&>(hull));
+			continue;
+		}
+		pieces.emplace(static_cast<Array<u32>&&>(front));
+		pieces.emplace(static_cast<Array<u32>&&>(back));
+	}
+}
+
+
+static void getTriangleBounds(Span<const Vec3> positions, const u32* tri, Vec3& min, Vec3& max)
+{
+	for (u32 j = 0; j < 3; ++j)
+	{
+		const Vec3& p = positions[tri[j]];
+		min = {minimum(min.x, p.x), minimum(min.y, p.y), minimum(min.z, p.z)};
+		max = {maximum(max.x, p.x), maximum(max.y, p.y), maximum(max.z, p.z)};
+	}
+}
+
+
+struct BVHBuilder
+{
+	BVHBuilder(Span<const Vec3> positions, Span<const u32> indices, Array<BVHNode>& nodes, IAllocator& allocator)
+		: positions(positions)
+		, indices(indices)
+		, nodes(nodes)
+		, order(allocator)
+		, centroids(allocator)
+	{
+	}
+
+	void build(u32 node_idx, u32 begin, u32 end)
+	{
+		BVHNode& node = nodes[node_idx];
+		node.min = Vec3(FLT_MAX, FLT_MAX, FLT_MAX);
+		node.max = Vec3(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+		Vec3 cmin = node.min, cmax = node.max;
+		for (u32 i = begin; i < end; ++i)
+		{
+			getTriangleBounds(positions, &indices[order[i] * 3], node.min, node.max);
+			const Vec3& c = centroids[order[i]];
+			cmin = {minimum(cmin.x, c.x), minimum(cmin.y, c.y), minimum(cmin.z, c.z)};
+			cmax = {maximum(cmax.x, c.x), maximum(cmax.y, c.y), maximum(cmax.z, c.z)};
+		}
+
+		if (end - begin <= max_leaf_triangles)
+		{
+			node.first = begin;
+			node.count = end - begin;
+			return;
+		}
+
+		// spatial middle of the centroid bounds, halves by count if all centroids end up on one side
+		const Vec3 size = cmax - cmin;
+		const int axis = size.x > size.y ? (size.x > size.z ? 0 : 2) : (size.y > size.z ? 1 : 2);
+		const float mid = (&cmin.x)[axis] + (&size.x)[axis] * 0.5f;
+		u32 split = begin;
+		for (u32 i = begin; i < end; ++i)
+		{
+			if ((&centroids[order[i]].x)[axis] < mid)
+			{
+				const u32 tmp = order[i];
+				order[i] = order[split];
+				order[split] = tmp;
+				++split;
+			}
+		}
+		if (split == begin || split == end) split = (begin + end) / 2;
+
+		node.count = 0;
+		nodes.emplace();
+		build(node_idx + 1, begin, split);
+		const u32 right = nodes.size();
+		nodes[node_idx].first = right;
+		nodes.emplace();
+		build(right, split, end);
+	}
+
+	Span<const Vec3> positions;
+	Span<const u32> indices;
+	Array<BVHNode>& nodes;
+	Array<u32> order;
+	Array<Vec3> centroids;
+	u32 max_leaf_triangles = 4;
+};
+
+
+void buildBVH(Span<const Vec3> positions, Span<u32> indices, u32 max_leaf_triangles, Array<BVHNode>& nodes, IAllocator& allocator)
+{
+	nodes.clear();
+	const u32 tri_count = indices.length() / 3;
+	if (tri_count == 0) return;
+
+	BVHBuilder builder(positions, Span<const u32>(indices.begin(), indices.end()), nodes, allocator);
+	builder.max_leaf_triangles = maximum(max_leaf_triangles, 1u);
+	builder.order.resize(tri_count);
+	builder.centroids.resize(tri_count);
+	for (u32 i = 0; i < tri_count; ++i)
+	{
+		builder.order[i] = i;
+		builder.centroids[i] = (positions[indices[i * 3]] + positions[indices[i * 3 + 1]] + positions[indices[i * 3 + 2]]) * (1 / 3.0f);
+	}
+	nodes.reserve(tri_count * 2);
+	nodes.emplace();
+	builder.build(0, 0, tri_count);
+
+	Array<u32> reordered(allocator);
+	reordered.resize(indices.length());
+	for (u32 i = 0; i < tri_count; ++i) memcpy(&reordered[i * 3], &indices[builder.order[i] * 3], sizeof(u32) * 3);
+	memcpy(indices.begin(), reordered.begin(), indices.length() * sizeof(u32));
+}
+
+
+} // namespace PhysicsCooker
+
+
+} // namespace Lumix
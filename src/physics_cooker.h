@@ -0,0 +1,70 @@
+#pragma once
+
+
+#include "engine/array.h"
+#include "engine/lumix.h"
+#include "engine/math.h"
+
+
+namespace Lumix
+{
+
+
+struct IAllocator;
+
+
+namespace PhysicsCooker
+{
+
+
+struct ConvexHull
+{
+	explicit ConvexHull(IAllocator& allocator)
+		: vertices(allocator)
+		, indices(allocator)
+	{
+	}
+
+	Array<Vec3> vertices;
+	// counter clockwise triangles seen from outside
+	Array<u16> indices;
+};
+
+
+// internal nodes are followed by their left child, leaves reference count triangles starting at first
+struct BVHNode
+{
+	Vec3 min;
+	Vec3 max;
+	// right child of internal nodes, first triangle of leaves
+	u32 first;
+	// 0 for internal nodes
+	u32 count;
+};
+
+
+// merges bitwise equal positions, remap maps every input position to the output one
+void weldPositions(Span<const Vec3> positions, Array<Vec3>& out, Array<u32>& remap, IAllocator& allocator);
+
+// quickhull, stops adding vertices at max_vertices so the hull is then an approximation from inside
+// returns false for flat and degenerate point sets
+bool computeConvexHull(Span<const Vec3> points, u32 max_vertices, ConvexHull& hull, IAllocator& allocator);
+
+// splits the mesh in halves along the longest axis until the hull of every part is within max_concavity
+// of the part's vertices, max_concavity is relative to the mesh extent
+void decompose(Span<const Vec3> positions,
+	Span<const u32> indices,
+	float max_concavity,
+	u32 max_hulls,
+	u32 max_vertices,
+	Array<ConvexHull>& hulls,
+	IAllocator& allocator);
+
+// reorders the triangles in indices to match the tree
+void buildBVH(Span<const Vec3> positions, Span<u32> indices, u32 max_leaf_triangles, Array<BVHNode>& nodes, IAllocator& allocator);
+
+
+} // namespace PhysicsCooker
+
+
+} // namespace Lumix
@@ -0,0 +1,621 @@
+#include "texture_compressor.h"
+#include "engine/math.h"
+#include <float.h>
+#include <math.h>
+#include <string.h>
+
+#define STB_IMAGE_STATIC
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb/stb_image.h"
+
+
+namespace Lumix
+{
+
+
+namespace TextureCompressor
+{
+
+
+static const u32 DDS_MAGIC = 0x20534444; // 'DDS '
+static const u32 DDSD_CAPS = 0x1;
+static const u32 DDSD_HEIGHT = 0x2;
+static const u32 DDSD_WIDTH = 0x4;
+static const u32 DDSD_PIXELFORMAT = 0x1000;
+static const u32 DDSD_MIPMAPCOUNT = 0x20000;
+static const u32 DDSD_LINEARSIZE = 0x80000;
+static const u32 DDPF_FOURCC = 0x4;
+static const u32 DDSCAPS_COMPLEX = 0x8;
+static const u32 DDSCAPS_TEXTURE = 0x1000;
+static const u32 DDSCAPS_MIPMAP = 0x400000;
+static const u32 FOURCC_DXT1 = 0x31545844;
+static const u32 FOURCC_DXT5 = 0x35545844;
+static const u32 FOURCC_ATI2 = 0x32495441;
+static const u32 FOURCC_DX10 = 0x30315844;
+static const u32 DXGI_FORMAT_BC7_UNORM = 98;
+static const u32 D3D10_RESOURCE_DIMENSION_TEXTURE2D = 3;
+static const u8 BC7_WEIGHTS4[16] = {0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64};
+
+
+struct DDSPixelFormat
+{
+	u32 size;
+	u32 flags;
+	u32 four_cc;
+	u32 rgb_bit_count;
+	u32 masks[4];
+};
+
+
+struct DDSHeader
+{
+	u32 magic;
+	u32 size;
+	u32 flags;
+	u32 height;
+	u32 width;
+	u32 pitch_or_linear_size;
+	u32 depth;
+	u32 mip_map_count;
+	u32 reserved1[11];
+	DDSPixelFormat pixel_format;
+	u32 caps[4];
+	u32 reserved2;
+};
+
+
+struct DDSHeaderDX10
+{
+	u32 dxgi_format;
+	u32 resource_dimension;
+	u32 misc_flag;
+	u32 array_size;
+	u32 misc_flags2;
+};
+
+
+// 16 pixels of a 4x4 block, RGBA
+typedef u8 BlockPixels[16][4];
+
+
+struct BitWriter
+{
+	void write(u64 value, u32 bits)
+	{
+		for (u32 i = 0; i < bits; ++i, ++pos)
+		{
+			if (value & (1ull << i)) data[pos >> 3] |= u8(1 << (pos & 7));
+		}
+	}
+
+	u8* data;
+	u32 pos = 0;
+};
+
+
+bool decode(Span<const u8> file, Array<u8>& rgba, u32& width, u32& height)
+{
+	int w, h, channels;
+	stbi_uc* pixels = stbi_load_from_memory(file.begin(), (int)file.length(), &w, &h, &channels, 4);
+	if (!pixels) return false;
+
+	width = (u32)w;
+	height = (u32)h;
+	rgba.resize(width * height * 4);
+	memcpy(rgba.begin(), pixels, rgba.size());
+	stbi_image_free(pixels);
+	return true;
+}
+
+
+bool hasAlpha(Span<const u8> rgba)
+{
+	for (u32 i = 3; i < rgba.length(); i += 4)
+	{
+		if (rgba[i] != 0xff) return true;
+	}
+	return false;
+}
+
+
+u32 getMipCount(u32 width, u32 height)
+{
+	u32 count = 1;
+	while (width > 1 || height > 1)
+	{
+		width = getMipSize(width, 1);
+		height = getMipSize(height, 1);
+		++count;
+	}
+	return count;
+}
+
+
+static float toLinear(u8 value)
+{
+	const float v = value / 255.0f;
+	return v <= 0.04045f ? v / 12.92f : powf((v + 0.055f) / 1.055f, 2.4f);
+}
+
+
+static u8 toSRGB(float value)
+{
+	const float v = value <= 0.0031308f ? value * 12.92f : 1.055f * powf(value, 1 / 2.4f) - 0.055f;
+	return u8(clamp(v * 255.0f + 0.5f, 0.0f, 255.0f));
+}
+
+
+void generateMips(Array<u8>& rgba, u32 width, u32 height, bool srgb)
+{
+	const u32 mip_count = getMipCount(width, height);
+	u32 total = 0;
+	for (u32 mip = 0; mip < mip_count; ++mip) total += getMipSize(width, mip) * getMipSize(height, mip) * 4;
+	rgba.resize(total);
+
+	float to_linear[256];
+	for (u32 i = 0; i < 256; ++i) to_linear[i] = srgb ? toLinear((u8)i) : i / 255.0f;
+
+	u32 src_offset = 0;
+	for (u32 mip = 1; mip < mip_count; ++mip)
+	{
+		const u32 src_w = getMipSize(width, mip - 1);
+		const u32 src_h = getMipSize(height, mip - 1);
+		const u32 dst_w = getMipSize(width, mip);
+		const u32 dst_h = getMipSize(height, mip);
+		const u8* src = rgba.begin() + src_offset;
+		u8* dst = rgba.begin() + src_offset + src_w * src_h * 4;
+		for (u32 y = 0; y < dst_h; ++y)
+		{
+			const u32 y0 = minimum(y * 2, src_h - 1);
+			const u32 y1 = minimum(y * 2 + 1, src_h - 1);
+			for (u32 x = 0; x < dst_w; ++x)
+			{
+				const u32 x0 = minimum(x * 2, src_w - 1);
+				const u32 x1 = minimum(x * 2 + 1, src_w - 1);
+				const u8* p[4] = {&src[(y0 * src_w + x0) * 4],
+					&src[(y0 * src_w + x1) * 4],
+					&src[(y1 * src_w + x0) * 4],
+					&src[(y1 * src_w + x1) * 4]};
+				u8* out = &dst[(y * dst_w + x) * 4];
+				for (u32 c = 0; c < 3; ++c)
+				{
+					const float v = (to_linear[p[0][c]] + to_linear[p[1][c]] + to_linear[p[2][c]] + to_linear[p[3][c]]) * 0.25f;
+					out[c] = srgb ? toSRGB(v) : u8(v * 255.0f + 0.5f);
+				}
+				out[3] = u8((p[0][3] + p[1][3] + p[2][3] + p[3][3] + 2) / 4);
+			}
+		}
+		src_offset += src_w * src_h * 4;
+	}
+}
+
+
+u32 getBlockSize(Format format)
+{
+	return format == Format::BC1 ? 8 : 16;
+}
+
+
+// edge blocks repeat the last row and column
+static void fetchBlock(const u8* rgba, u32 width, u32 height, u32 bx, u32 by, BlockPixels& out)
+{
+	for (u32 y = 0; y < 4; ++y)
+	{
+		const u32 sy = minimum(by * 4 + y, height - 1);
+		for (u32 x = 0; x < 4; ++x)
+		{
+			const u32 sx = minimum(bx * 4 + x, width - 1);
+			memcpy(out[y * 4 + x], &rgba[(sy * width + sx) * 4], 4);
+		}
+	}
+}
+
+
+// mean and the direction of the largest variance of the first channels components, by power iteration
+static void getPrincipalAxis(const BlockPixels& px, u32 channels, float* mean, float* axis)
+{
+	for (u32 c = 0; c < channels; ++c)
+	{
+		mean[c] = 0;
+		for (u32 i = 0; i < 16; ++i) mean[c] += px[i][c];
+		mean[c] /= 16;
+	}
+
+	float cov[4][4] = {};
+	for (u32 i = 0; i < 16; ++i)
+	{
+		float d[4];
+		for (u32 c = 0; c < channels; ++c) d[c] = px[i][c] - mean[c];
+		for (u32 a = 0; a < channels; ++a)
+		{
+			for (u32 b = 0; b < channels; ++b) cov[a][b] += d[a] * d[b];
+		}
+	}
+
+	for (u32 c = 0; c < channels; ++c) axis[c] = 1;
+	for (u32 iter = 0; iter < 8; ++iter)
+	{
+		float tmp[4] = {};
+		float len = 0;
+		for (u32 a = 0; a < channels; ++a)
+		{
+			for (u32 b = 0; b < channels; ++b) tmp[a] += cov[a][b] * axis[b];
+			len = maximum(len, fabsf(tmp[a]));
+		}
+		if (len < 1e-6f) break;
+		for (u32 c = 0; c < channels; ++c) axis[c] = tmp[c] / len;
+	}
+}
+
+
+// endpoints at the extremes of the pixels projected on the principal axis
+static void getAxisEndpoints(const BlockPixels& px, u32 channels, float* e0, float* e1)
+{
+	float mean[4], axis[4];
+	getPrincipalAxis(px, channels, mean, axis);
+	float t_min = FLT_MAX, t_max = -FLT_MAX;
+	for (u32 i = 0; i < 16; ++i)
+	{
+		float t = 0;
+		for (u32 c = 0; c < channels; ++c) t += (px[i][c] - mean[c]) * axis[c];
+		t_min = minimum(t_min, t);
+		t_max = maximum(t_max, t);
+	}
+	float len = 0;
+	for (u32 c = 0; c < channels; ++c) len += axis[c] * axis[c];
+	if (len > 0)
+	{
+		t_min /= len;
+		t_max /= len;
+	}
+	for (u32 c = 0; c < channels; ++c)
+	{
+		e0[c] = clamp(mean[c] + axis[c] * t_min, 0.0f, 255.0f);
+		e1[c] = clamp(mean[c] + axis[c] * t_max, 0.0f, 255.0f);
+	}
+}
+
+
+// least squares endpoints for given per pixel interpolation weights, weights[i] is the weight of e1
+static bool fitEndpoints(const BlockPixels& px, u32 channels, const float* weights, float* e0, float* e1)
+{
+	float aa = 0, bb = 0, ab = 0;
+	float ax[4] = {}, bx[4] = {};
+	for (u32 i = 0; i < 16; ++i)
+	{
+		const float b = weights[i];
+		const float a = 1 - b;
+		aa += a * a;
+		bb += b * b;
+		ab += a * b;
+		for (u32 c = 0; c < channels; ++c)
+		{
+			ax[c] += a * px[i][c];
+			bx[c] += b * px[i][c];
+		}
+	}
+	const float det = aa * bb - ab * ab;
+	if (fabsf(det) < 1e-6f) return false;
+
+	for (u32 c = 0; c < channels; ++c)
+	{
+		e0[c] = clamp((ax[c] * bb - bx[c] * ab) / det, 0.0f, 255.0f);
+		e1[c] = clamp((bx[c] * aa - ax[c] * ab) / det, 0.0f, 255.0f);
+	}
+	return true;
+}
+
+
+static u16 to565(const float* color)
+{
+	const u32 r = (u32)clamp(color[0] * 31 / 255 + 0.5f, 0.0f, 31.0f);
+	const u32 g = (u32)clamp(color[1] * 63 / 255 + 0.5f, 0.0f, 63.0f);
+	const u32 b = (u32)clamp(color[2] * 31 / 255 + 0.5f, 0.0f, 31.0f);
+	return u16((r << 11) | (g << 5) | b);
+}
+
+
+static void from565(u16 value, float* color)
+{
+	const u32 r = (value >> 11) & 31;
+	const u32 g = (value >> 5) & 63;
+	const u32 b = value & 31;
+	color[0] = float((r << 3) | (r >> 2));
+	color[1] = float((g << 2) | (g >> 4));
+	color[2] = float((b << 3) | (b >> 2));
+}
+
+
+// four color mode palette, returns the squared error
+static float getBC1Indices(const BlockPixels& px, u16 c0, u16 c1, u32& indices)
+{
+	float palette[4][3];
+	from565(c0, palette[0]);
+	from565(c1, palette[1]);
+	for (u32 c = 0; c < 3; ++c)
+	{
+		palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+		palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+	}
+
+	float error = 0;
+	indices = 0;
+	for (u32 i = 0; i < 16; ++i)
+	{
+		u32 best = 0;
+		float best_dist = FLT_MAX;
+		for (u32 j = 0; j < 4; ++j)
+		{
+			float dist = 0;
+			for (u32 c = 0; c < 3; ++c) dist += (px[i][c] - palette[j][c]) * (px[i][c] - palette[j][c]);
+			if (dist < best_dist)
+			{
+				best_dist = dist;
+				best = j;
+			}
+		}
+		indices |= best << (i * 2);
+		error += best_dist;
+	}
+	return error;
+}
+
+
+static void encodeBC1(const BlockPixels& px, u8* out)
+{
+	static const float WEIGHTS[4] = {0, 1, 1 / 3.0f, 2 / 3.0f};
+
+	float e0[4], e1[4];
+	getAxisEndpoints(px, 3, e0, e1);
+	u16 c0 = to565(e1);
+	u16 c1 = to565(e0);
+	u32 indices;
+	float error = getBC1Indices(px, c0, c1, indices);
+
+	float weights[16];
+	for (u32 i = 0; i < 16; ++i) weights[i] = WEIGHTS[(indices >> (i * 2)) & 3];
+	if (fitEndpoints(px, 3, weights, e0, e1))
+	{
+		const u16 refined0 = to565(e0);
+		const u16 refined1 = to565(e1);
+		u32 refined_indices;
+		if (getBC1Indices(px, refined0, refined1, refined_indices) < error)
+		{
+			c0 = refined0;
+			c1 = refined1;
+			indices = refined_indices;
+		}
+	}
+
+	// c0 > c1 selects the four color mode, swapping the endpoints swaps indices 0<->1 and 2<->3
+	if (c0 < c1)
+	{
+		const u16 tmp = c0;
+		c0 = c1;
+		c1 = tmp;
+		indices ^= 0x55555555;
+	}
+	else if (c0 == c1)
+	{
+		indices = 0;
+	}
+	memcpy(out, &c0, 2);
+	memcpy(out + 2, &c1, 2);
+	memcpy(out + 4, &indices, 4);
+}
+
+
+// BC3 alpha and BC5 channel block, eight value mode
+static void encodeChannel(const BlockPixels& px, u32 channel, u8* out)
+{
+	u8 min = 255, max = 0;
+	for (u32 i = 0; i < 16; ++i)
+	{
+		min = minimum(min, px[i][channel]);
+		max = maximum(max, px[i][channel]);
+	}
+	out[0] = max;
+	out[1] = min;
+	memset(out + 2, 0, 6);
+	if (min == max) return;
+
+	float palette[8];
+	palette[0] = max;
+	palette[1] = min;
+	for (u32 i = 2; i < 8; ++i) palette[i] = ((8 - i) * max + (i - 1) * min) / 7.0f;
+
+	u64 indices = 0;
+	for (u32 i = 0; i < 16; ++i)
+	{
+		u32 best = 0;
+		float best_dist = FLT_MAX;
+		for (u32 j = 0; j < 8; ++j)
+		{
+			const float dist = fabsf(px[i][channel] - palette[j]);
+			if (dist < best_dist)
+			{
+				best_dist = dist;
+				best = j;
+			}
+		}
+		indices |= (u64)best << (i * 3);
+	}
+	for (u32 i = 0; i < 6; ++i) out[2 + i] = u8(indices >> (i * 8));
+}
+
+
+// 7 bits per component and a p-bit shared by the endpoint's components, returns the 8-bit values
+static void quantizeBC7Endpoint(const float* endpoint, u8* q, u8& pbit, u8* values)
+{
+	float best_error = FLT_MAX;
+	for (u8 p = 0; p < 2; ++p)
+	{
+		u8 tmp[4];
+		float error = 0;
+		for (u32 c = 0; c < 4; ++c)
+		{
+			tmp[c] = (u8)clamp((endpoint[c] - p) / 2 + 0.5f, 0.0f, 127.0f);
+			const float d = (tmp[c] * 2 + p) - endpoint[c];
+			error += d * d;
+		}
+		if (error < best_error)
+		{
+			best_error = error;
+			pbit = p;
+			memcpy(q, tmp, 4);
+		}
+	}
+	for (u32 c = 0; c < 4; ++c) values[c] = u8(q[c] * 2 + pbit);
+}
+
+
+static float getBC7Indices(const BlockPixels& px, const u8* v0, const u8* v1, u8* indices)
+{
+	u8 palette[16][4];
+	for (u32 j = 0; j < 16; ++j)
+	{
+		const u32 w = BC7_WEIGHTS4[j];
+		for (u32 c = 0; c < 4; ++c) palette[j][c] = u8(((64 - w) * v0[c] + w * v1[c] + 32) >> 6);
+	}
+
+	float error = 0;
+	for (u32 i = 0; i < 16; ++i)
+	{
+		u32 best = 0;
+		i32 best_dist = 0x7fffFFFF;
+		for (u32 j = 0; j < 16; ++j)
+		{
+			i32 dist = 0;
+			for (u32 c = 0; c < 4; ++c) dist += (px[i][c] - palette[j][c]) * (px[i][c] - palette[j][c]);
+			if (dist < best_dist)
+			{
+				best_dist = dist;
+				best = j;
+			}
+		}
+		indices[i] = (u8)best;
+		error += (float)best_dist;
+	}
+	return error;
+}
+
+
+// mode 6 - one subset, RGBA endpoints with 7 bits and a p-bit, 4-bit indices
+static void encodeBC7(const BlockPixels& px, u8* out)
+{
+	float e0[4], e1[4];
+	getAxisEndpoints(px, 4, e0, e1);
+
+	u8 q[2][4], pbits[2], values[2][4], indices[16];
+	quantizeBC7Endpoint(e0, q[0], pbits[0], values[0]);
+	quantizeBC7Endpoint(e1, q[1], pbits[1], values[1]);
+	float error = getBC7Indices(px, values[0], values[1], indices);
+
+	float weights[16];
+	for (u32 i = 0; i < 16; ++i) weights[i] = BC7_WEIGHTS4[indices[i]] / 64.0f;
+	if (fitEndpoints(px, 4, weights, e0, e1))
+	{
+		u8 refined_q[2][4], refined_pbits[2], refined_values[2][4], refined_indices[16];
+		quantizeBC7Endpoint(e0, refined_q[0], refined_pbits[0], refined_values[0]);
+		quantizeBC7Endpoint(e1, refined_q[1], refined_pbits[1], refined_values[1]);
+		if (getBC7Indices(px, refined_values[0], refined_values[1], refined_indices) < error)
+		{
+			memcpy(q, refined_q, sizeof(q));
+			memcpy(pbits, refined_pbits, sizeof(pbits));
+			memcpy(indices, refined_indices, sizeof(indices));
+		}
+	}
+
+	// the first index is stored without its top bit, so it must be < 8
+	const u32 e = indices[0] >= 8 ? 1 : 0;
+	if (e)
+	{
+		for (u32 i = 0; i < 16; ++i) indices[i] = u8(15 - indices[i]);
+	}
+
+	memset(out, 0, 16);
+	BitWriter writer;
+	writer.data = out;
+	writer.write(1 << 6, 7);
+	for (u32 c = 0; c < 4; ++c)
+	{
+		writer.write(q[e][c], 7);
+		writer.write(q[1 - e][c], 7);
+	}
+	writer.write(pbits[e], 1);
+	writer.write(pbits[1 - e], 1);
+	writer.write(indices[0], 3);
+	for (u32 i = 1; i < 16; ++i) writer.write(indices[i], 4);
+}
+
+
+void compressBlocks(Format format, const u8* rgba, u32 width, u32 height, u32 first_row, u32 row_count, u8* out)
+{
+	const u32 blocks_x = getBlockCount(width);
+	const u32 block_size = getBlockSize(format);
+	BlockPixels px;
+	for (u32 by = first_row; by < first_row + row_count; ++by)
+	{
+		for (u32 bx = 0; bx < blocks_x; ++bx)
+		{
+			fetchBlock(rgba, width, height, bx, by, px);
+			switch (format)
+			{
+				case Format::BC1: encodeBC1(px, out); break;
+				case Format::BC3:
+					encodeChannel(px, 3, out);
+					encodeBC1(px, out + 8);
+					break;
+				case Format::BC5:
+					encodeChannel(px, 0, out);
+					encodeChannel(px, 1, out + 8);
+					break;
+				case Format::BC7: encodeBC7(px, out); break;
+			}
+			out += block_size;
+		}
+	}
+}
+
+
+u32 getDDSHeaderSize(Format format)
+{
+	return sizeof(DDSHeader) + (format == Format::BC7 ? sizeof(DDSHeaderDX10) : 0);
+}
+
+
+void writeDDSHeader(Format format, u32 width, u32 height, u32 mip_count, u8* out)
+{
+	DDSHeader header = {};
+	header.magic = DDS_MAGIC;
+	header.size = sizeof(DDSHeader) - sizeof(header.magic);
+	header.flags = DDSD_CAPS | DDSD_HEIGHT | DDSD_WIDTH | DDSD_PIXELFORMAT | DDSD_MIPMAPCOUNT | DDSD_LINEARSIZE;
+	header.height = height;
+	header.width = width;
+	header.pitch_or_linear_size = getBlockCount(width) * getBlockCount(height) * getBlockSize(format);
+	header.mip_map_count = mip_count;
+	header.pixel_format.size = sizeof(DDSPixelFormat);
+	header.pixel_format.flags = DDPF_FOURCC;
+	switch (format)
+	{
+		case Format::BC1: header.pixel_format.four_cc = FOURCC_DXT1; break;
+		case Format::BC3: header.pixel_format.four_cc = FOURCC_DXT5; break;
+		case Format::BC5: header.pixel_format.four_cc = FOURCC_ATI2; break;
+		case Format::BC7: header.pixel_format.four_cc = FOURCC_DX10; break;
+	}
+	header.caps[0] = DDSCAPS_TEXTURE | (mip_count > 1 ? DDSCAPS_COMPLEX | DDSCAPS_MIPMAP : 0);
+	memcpy(out, &header, sizeof(header));
+	if (format != Format::BC7) return;
+
+	DDSHeaderDX10 dx10 = {};
+	dx10.dxgi_format = DXGI_FORMAT_BC7_UNORM;
+	dx10.resource_dimension = D3D10_RESOURCE_DIMENSION_TEXTURE2D;
+	dx10.array_size = 1;
+	memcpy(out + sizeof(header), &dx10, sizeof(dx10));
+}
+
+
+} // namespace TextureCompressor
+
+
+} // namespace Lumix
@@ -0,0 +1,63 @@
+#pragma once
+
+
+#include "engine/array.h"
+#include "engine/lumix.h"
+
+
+namespace Lumix
+{
+
+
+namespace TextureCompressor
+{
+
+
+enum class Format : u8
+{
+	// RGB, 1-bit alpha is not used
+	BC1,
+	// RGB with interpolated alpha
+	BC3,
+	// two independent channels, for normal maps
+	BC5,
+	// RGBA, mode 6 only
+	BC7
+};
+
+// decodes anything stb_image can read to RGBA8, returns false if the image is not supported
+bool decode(Span<const u8> file, Array<u8>& rgba, u32& width, u32& height);
+
+bool hasAlpha(Span<const u8> rgba);
+
+inline u32 getMipSize(u32 size, u32 mip)
+{
+	return size >> mip ? size >> mip : 1;
+}
+
+u32 getMipCount(u32 width, u32 height);
+
+// appends all levels below the one in rgba, a 2x2 box filter, done in linear space for srgb images
+void generateMips(Array<u8>& rgba, u32 width, u32 height, bool srgb);
+
+inline u32 getBlockCount(u32 size)
+{
+	return (size + 3) / 4;
+}
+
+u32 getBlockSize(Format format);
+
+// sizes are of the level being compressed
+// compresses block rows [first_row, first_row + row_count), out points to the first row's blocks
+void compressBlocks(Format format, const u8* rgba, u32 width, u32 height, u32 first_row, u32 row_count, u8* out);
+
+// DX10 extended header for BC7, DXT1, DXT5 and ATI2 fourCC otherwise
+// color space is not stored, materials say which textures are srgb
+u32 getDDSHeaderSize(Format format);
+void writeDDSHeader(Format format, u32 width, u32 height, u32 mip_count, u8* out);
+
+
+} // namespace TextureCompressor
+
+
+} // namespace Lumix